@@ -0,0 +1,121 @@
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "ambient.h"
+
+#include "sdkconfig.h"
+
+#ifdef CONFIG_ALARM_AMBIENT
+
+#include "filter.h"
+#include "light.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_adc/adc_continuous.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+
+#define AMBIENT_FRAME 256       // samples per DMA frame, the CPU wakes 4 times a second
+
+static adc_continuous_handle_t handle = NULL;
+static TaskHandle_t task = NULL;
+static struct filter filter;
+
+static bool ambient_done(adc_continuous_handle_t, const adc_continuous_evt_data_t *, void *);
+static void ambient_task(void *);
+
+const char *ambient_init()
+{
+    if (handle) {
+        return NULL;
+    }
+    filter_start(&filter);
+    adc_continuous_handle_cfg_t handle_cfg = {
+        .max_store_buf_size = AMBIENT_FRAME * SOC_ADC_DIGI_RESULT_BYTES * 4,
+        .conv_frame_size = AMBIENT_FRAME * SOC_ADC_DIGI_RESULT_BYTES
+    };
+    if (adc_continuous_new_handle(&handle_cfg, &handle) != ESP_OK) {
+        return "Unable to create ambient light ADC.";
+    }
+    adc_digi_pattern_config_t pattern = {
+        .atten = ADC_ATTEN_DB_12,
+        .channel = CONFIG_ALARM_AMBIENT_CHANNEL,
+        .unit = ADC_UNIT_1,
+        .bit_width = SOC_ADC_DIGI_MAX_BITWIDTH
+    };
+    adc_continuous_config_t config = {
+        .pattern_num = 1,
+        .adc_pattern = &pattern,
+        .sample_freq_hz = FILTER_RATE,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1
+    };
+    if (adc_continuous_config(handle, &config) != ESP_OK) {
+        return "Unable to setup ambient light ADC.";
+    }
+    if (xTaskCreate(ambient_task, "ambient", 2048, NULL, 1, &task) != pdPASS) {
+        return "Unable to create ambient light task.";
+    }
+    const adc_continuous_evt_cbs_t callbacks = {
+        .on_conv_done = ambient_done
+    };
+    if (adc_continuous_register_event_callbacks(handle, &callbacks, NULL) != ESP_OK) {
+        return "Unable to register ambient light callback.";
+    }
+    if (adc_continuous_start(handle) != ESP_OK) {
+        return "Unable to start ambient light ADC.";
+    }
+    return NULL;
+}
+
+// A whole frame landed in the pool, samples themselves never interrupt.
+static bool IRAM_ATTR ambient_done(adc_continuous_handle_t adc, const adc_continuous_evt_data_t *event, void *ctx)
+{
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(task, &woken);
+    return woken == pdTRUE;
+}
+
+static void ambient_task(void *arg)
+{
+    static unsigned char raw[AMBIENT_FRAME * SOC_ADC_DIGI_RESULT_BYTES];
+    static adc_continuous_data_t parsed[AMBIENT_FRAME];
+    static unsigned short samples[AMBIENT_FRAME];
+    unsigned short applied = LIGHT_SCALE_UNIT;
+    long long updated = 0;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        uint32_t size;
+        while (adc_continuous_read(handle, raw, sizeof(raw), &size, 0) == ESP_OK) {
+            uint32_t count = 0;
+            if (adc_continuous_parse_data(handle, raw, size, parsed, &count) != ESP_OK) {
+                continue;
+            }
+            size_t valid = 0;
+            for (uint32_t i = 0; i < count; i++) {
+                if (parsed[i].valid) {
+                    samples[valid++] = parsed[i].raw_data;
+                }
+            }
+            if (!filter_feed(&filter, samples, valid)) {
+                continue;
+            }
+            unsigned short scale = filter_scale(filter_level(&filter));
+            long long now = esp_timer_get_time();
+            if (abs(scale - applied) >= FILTER_STEP && now - updated >= FILTER_PERIOD * 1000LL) {
+                light_scale(scale);
+                applied = scale;
+                updated = now;
+            }
+        }
+    }
+}
+
+#else
+
+const char *ambient_init()
+{
+    return NULL;
+}
+
+#endif
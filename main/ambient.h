@@ -0,0 +1,6 @@
+#ifndef _AMBIENT_H
+#define _AMBIENT_H
+
+const char *ambient_init();
+
+#endif
@@ -0,0 +1,353 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "api.h"
+#include "data.h"
+#include "field.h"
+#include "snapshot.h"
+#include "power.h"
+#include "body.h"
+#include "engine.h"
+#include "zone.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "cJSON.h"
+#include "esp_http_server.h"
+#include "esp_rom_crc.h"
+
+#define API_ALARM 384           // one alarm as json
+#define API_BODY (DATA_ALARMS * API_ALARM)      // whole set as json
+
+#if API_BODY > BODY_SIZE
+#error "Alarm sets do not fit the request body buffers"
+#endif
+
+static struct {
+    struct data *data;
+    SemaphoreHandle_t signal;
+} __attribute__((packed)) context;
+
+// handlers run on the single alarm server task, responses and edits are built here
+static char response[SNAPSHOT_SIZE > API_ALARM ? SNAPSHOT_SIZE : API_ALARM];
+static struct data staged;      // stored before the running copy changes
+static struct snapshot snapshot;
+
+static esp_err_t route_alarms_get_handler(httpd_req_t *);
+static esp_err_t route_alarms_put_handler(httpd_req_t *);
+static esp_err_t route_alarms_delete_handler(httpd_req_t *);
+static esp_err_t route_config_get_handler(httpd_req_t *);
+static esp_err_t route_config_put_handler(httpd_req_t *);
+static int api_index(httpd_req_t *);
+static void api_etag(char *);
+static esp_err_t api_send(httpd_req_t *, int);
+static size_t api_alarm(char *, size_t, const struct alarm *);
+static const char *api_parse(const cJSON *, struct alarm *);
+
+const char *api_register(void *server, struct data *data, void *signal)
+{
+    context.data = data;
+    context.signal = *(SemaphoreHandle_t *) signal;
+    const char *const uris[] = { "/alarms", "/alarms/*" };
+    for (unsigned char i = 0; i < sizeof(uris) / sizeof(*uris); i++) {
+        const httpd_uri_t route_get = {
+            .uri = uris[i],
+            .method = HTTP_GET,
+            .handler = route_alarms_get_handler
+        };
+        if (power_route(server, &route_get) != ESP_OK) {
+            return "Unable to register alarms http read route.";
+        }
+        const httpd_uri_t route_put = {
+            .uri = uris[i],
+            .method = HTTP_PUT,
+            .handler = route_alarms_put_handler
+        };
+        if (power_route(server, &route_put) != ESP_OK) {
+            return "Unable to register alarms http update route.";
+        }
+    }
+    const httpd_uri_t route_delete = {
+        .uri = "/alarms/*",
+        .method = HTTP_DELETE,
+        .handler = route_alarms_delete_handler
+    };
+    if (power_route(server, &route_delete) != ESP_OK) {
+        return "Unable to register alarms http delete route.";
+    }
+    const httpd_uri_t route_config_get = {
+        .uri = "/config",
+        .method = HTTP_GET,
+        .handler = route_config_get_handler
+    };
+    if (power_route(server, &route_config_get) != ESP_OK) {
+        return "Unable to register config http export route.";
+    }
+    const httpd_uri_t route_config_put = {
+        .uri = "/config",
+        .method = HTTP_PUT,
+        .handler = route_config_put_handler
+    };
+    if (power_route(server, &route_config_put) != ESP_OK) {
+        return "Unable to register config http import route.";
+    }
+    return NULL;
+}
+
+static esp_err_t route_alarms_get_handler(httpd_req_t *req)
+{
+    int index = api_index(req);
+    if (index < -1 || index >= context.data->alarms) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Alarm not found");
+        return ESP_FAIL;
+    }
+    char etag[11];
+    char match[sizeof(etag)];
+    api_etag(etag);
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", match, sizeof(match)) == ESP_OK && !strcmp(match, etag)) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        httpd_resp_set_hdr(req, "ETag", etag);
+        httpd_resp_send(req, NULL, 0);
+        return ESP_OK;
+    }
+    return api_send(req, index);
+}
+
+// Replace the whole set, edit an alarm, or append one at the position after the last.
+static esp_err_t route_alarms_put_handler(httpd_req_t *req)
+{
+    int index = api_index(req);
+    if (index < -1 || index > context.data->alarms) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Alarm not found");
+        return ESP_FAIL;
+    }
+    char *buffer = body_read(req, API_BODY);
+    if (!buffer) {
+        return ESP_FAIL;
+    }
+    cJSON *root = cJSON_Parse(buffer);
+    body_release(buffer);
+    if (!root) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Failed to parse json");
+        return ESP_FAIL;
+    }
+    // new alarms start from zero, existing ones keep the fields absent from the body
+    memcpy(&staged, context.data, sizeof(struct data));
+    unsigned short count = staged.alarms;
+    memset(&staged.alarm[count], 0, (DATA_ALARMS - count) * sizeof(struct alarm));
+    const char *err = NULL;
+    if (index >= 0) {
+        if (index == DATA_ALARMS) {
+            err = "Too many alarms";
+        } else if (!(err = api_parse(root, &staged.alarm[index])) && index == count) {
+            count++;
+        }
+    } else if (!cJSON_IsArray(root)) {
+        err = "Expected an array of alarms";
+    } else if (cJSON_GetArraySize(root) > DATA_ALARMS) {
+        err = "Too many alarms";
+    } else {
+        count = cJSON_GetArraySize(root);
+        for (int i = 0; i < count && !err; i++) {
+            err = api_parse(cJSON_GetArrayItem(root, i), &staged.alarm[i]);
+        }
+    }
+    cJSON_Delete(root);
+    if (err) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, err);
+        return ESP_FAIL;
+    }
+    if (count != context.data->alarms || memcmp(staged.alarm, context.data->alarm, count * sizeof(struct alarm))) {
+        // flash first, a failed write leaves the running alarms as stored
+        staged.alarms = count;
+        if ((err = data_write(&staged))) {
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, err);
+            return ESP_FAIL;
+        }
+        engine_lock();
+        if (index >= 0) {
+            context.data->alarm[index] = staged.alarm[index];
+            context.data->alarms = count;
+            engine_update(index);
+        } else if (count == context.data->alarms) {
+            for (int i = 0; i < count; i++) {
+                if (memcmp(&staged.alarm[i], &context.data->alarm[i], sizeof(struct alarm))) {
+                    context.data->alarm[i] = staged.alarm[i];
+                    engine_update(i);
+                }
+            }
+        } else {
+            memcpy(context.data->alarm, staged.alarm, sizeof(staged.alarm));
+            context.data->alarms = count;
+            engine_update(ENGINE_ALL);
+        }
+        engine_unlock();
+        xSemaphoreGive(context.signal);
+    }
+    return api_send(req, index);
+}
+
+// Remove an alarm, the following ones move down a position.
+static esp_err_t route_alarms_delete_handler(httpd_req_t *req)
+{
+    int index = api_index(req);
+    if (index < 0 || index >= context.data->alarms) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Alarm not found");
+        return ESP_FAIL;
+    }
+    memcpy(&staged, context.data, sizeof(struct data));
+    unsigned short count = --staged.alarms;
+    memmove(&staged.alarm[index], &staged.alarm[index + 1], (count - index) * sizeof(struct alarm));
+    memset(&staged.alarm[count], 0, sizeof(struct alarm));
+    const char *err;
+    if ((err = data_write(&staged))) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, err);
+        return ESP_FAIL;
+    }
+    engine_lock();
+    memcpy(context.data, &staged, sizeof(struct data));
+    engine_remove(index);
+    engine_unlock();
+    xSemaphoreGive(context.signal);
+    return api_send(req, -1);
+}
+
+static esp_err_t route_config_get_handler(httpd_req_t *req)
+{
+    size_t len = snapshot_encode(context.data, (unsigned char *)response);
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"alarm-clock.bin\"");
+    return httpd_resp_send(req, response, len);
+}
+
+// Decode the body while it arrives, only a small chunk is held at a time.
+static esp_err_t route_config_put_handler(httpd_req_t *req)
+{
+    size_t total = req->content_len;
+    if (total > SNAPSHOT_SIZE) {
+        httpd_resp_send_err(req, HTTPD_413_CONTENT_TOO_LARGE, "Snapshot too long.");
+        return ESP_FAIL;
+    }
+    snapshot_begin(&snapshot);
+    unsigned char buffer[128];
+    const char *err = NULL;
+    size_t cur_len = 0;
+    while (cur_len < total) {
+        int received = httpd_req_recv(req, (char *)buffer, total - cur_len < sizeof(buffer) ? total - cur_len :
+                                      sizeof(buffer));
+        if (received <= 0) {
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to receive snapshot");
+            return ESP_FAIL;
+        }
+        cur_len += received;
+        if ((err = snapshot_feed(&snapshot, buffer, received))) {
+            break;
+        }
+    }
+    if (err || (err = snapshot_end(&snapshot))) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, err);
+        return ESP_FAIL;
+    }
+    if ((err = data_write(&snapshot.data))) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, err);
+        return ESP_FAIL;
+    }
+    engine_lock();
+    memcpy(context.data, &snapshot.data, sizeof(struct data));
+    zone_set(context.data->timezone);
+    engine_update(ENGINE_ALL);
+    engine_unlock();
+    xSemaphoreGive(context.signal);
+    httpd_resp_sendstr(req, "Configuration imported, network changes apply after restart");
+    return ESP_OK;
+}
+
+// Alarm position from the uri, -1 for the whole set and -2 when invalid.
+static int api_index(httpd_req_t *req)
+{
+    const char *uri = req->uri + sizeof("/alarms") - 1;
+    if (!*uri || *uri == '?') {
+        return -1;
+    }
+    char *end;
+    long index = strtol(uri + 1, &end, 10);
+    if (end == uri + 1 || (*end && *end != '?') || index < 0 || index > DATA_ALARMS) {
+        return -2;
+    }
+    return index;
+}
+
+// Alarm set checksum, changes with any field or the count, stable across reboots.
+static void api_etag(char *etag)
+{
+    const struct data *data = context.data;
+    unsigned int crc = esp_rom_crc32_le(0, (const unsigned char *)&data->alarms, sizeof(data->alarms));
+    crc = esp_rom_crc32_le(crc, (const unsigned char *)data->alarm, data->alarms * sizeof(struct alarm));
+    snprintf(etag, 11, "\"%08lx\"", (unsigned long)crc);
+}
+
+// The alarm at index or the whole set, sent an alarm per chunk.
+static esp_err_t api_send(httpd_req_t *req, int index)
+{
+    char etag[11];
+    api_etag(etag);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "ETag", etag);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    if (index >= 0) {
+        return httpd_resp_send(req, response, api_alarm(response, sizeof(response), &context.data->alarm[index]));
+    }
+    if (!context.data->alarms) {
+        return httpd_resp_sendstr(req, "[]");
+    }
+    for (int i = 0; i < context.data->alarms; i++) {
+        response[0] = i ? ',' : '[';
+        size_t len = 1 + api_alarm(response + 1, sizeof(response) - 2, &context.data->alarm[i]);
+        if (i == context.data->alarms - 1) {
+            response[len++] = ']';
+        }
+        if (httpd_resp_send_chunk(req, response, len) != ESP_OK) {
+            return ESP_FAIL;
+        }
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+static size_t api_alarm(char *buffer, size_t size, const struct alarm *alarm)
+{
+    size_t len = 0;
+    for (unsigned char i = 0; i < FIELD_ALARM; i++) {
+        len += snprintf(buffer + len, size - len, "%c\"%s\":%u", i ? ',' : '{', field_alarm[i].name,
+                        ((const unsigned char *)alarm)[field_alarm[i].offset]);
+    }
+    buffer[len++] = '}';
+    return len;
+}
+
+// Apply the fields present on the object, values are checked before anything is changed.
+static const char *api_parse(const cJSON *object, struct alarm *alarm)
+{
+    if (!cJSON_IsObject(object)) {
+        return "Expected an alarm object";
+    }
+    struct alarm copy = *alarm;
+    for (unsigned char i = 0; i < FIELD_ALARM; i++) {
+        const cJSON *node = cJSON_GetObjectItem(object, field_alarm[i].name);
+        if (!node) {
+            continue;
+        }
+        if (!cJSON_IsNumber(node) || node->valuedouble != node->valueint || node->valueint < 0 ||
+            node->valueint > field_alarm[i].max) {
+            static char message[64];
+            snprintf(message, sizeof(message), "Invalid %s", field_alarm[i].name);
+            return message;
+        }
+        ((unsigned char *)&copy)[field_alarm[i].offset] = node->valueint;
+    }
+    if (!field_valid(&copy)) {
+        return "Invalid date";
+    }
+    *alarm = copy;
+    return NULL;
+}
@@ -0,0 +1,8 @@
+#ifndef _API_H
+#define _API_H
+
+struct data;
+
+const char *api_register(void *server, struct data *, void *signal);
+
+#endif
@@ -0,0 +1,116 @@
+#include <stdio.h>
+
+#include "body.h"
+#include "power.h"
+
+#include "freertos/FreeRTOS.h"
+#include "esp_http_server.h"
+
+#if BODY_BUFFERS > 32
+#error "The body pool tracks its buffers in a 32 bit mask"
+#endif
+
+static char buffers[BODY_BUFFERS][BODY_SIZE + 1];
+
+static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+static unsigned int used = 0;   // bit per checked out buffer
+static unsigned char peak = 0;
+static unsigned int checkouts = 0;
+static unsigned int exhausted = 0;
+
+static char *body_checkout();
+static esp_err_t route_body_handler(httpd_req_t *);
+
+// Whole request body in a pooled buffer, NUL terminated. NULL once the error response went out, 413 past the limit and
+// 503 without waiting should handlers ever overlap with every buffer out.
+char *body_read(void *handle, size_t limit)
+{
+    httpd_req_t *req = handle;
+    size_t total = req->content_len;
+    if (total > limit || total > BODY_SIZE) {
+        httpd_resp_send_err(req, HTTPD_413_CONTENT_TOO_LARGE, "Content too long");
+        return NULL;
+    }
+    char *buffer = body_checkout();
+    if (!buffer) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_hdr(req, "Retry-After", "1");
+        httpd_resp_sendstr(req, "Busy, try again");
+        return NULL;
+    }
+    size_t cur_len = 0;
+    while (cur_len < total) {
+        int received = httpd_req_recv(req, buffer + cur_len, total - cur_len);
+        if (received <= 0) {
+            body_release(buffer);
+            httpd_resp_send_err(req, received == HTTPD_SOCK_ERR_TIMEOUT ? HTTPD_408_REQ_TIMEOUT :
+                                HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to receive body");
+            return NULL;
+        }
+        cur_len += received;
+    }
+    buffer[total] = 0;
+    return buffer;
+}
+
+void body_release(char *buffer)
+{
+    if (!buffer) {
+        return;
+    }
+    portENTER_CRITICAL(&lock);
+    used &= ~(1U << (buffer - buffers[0]) / sizeof(*buffers));
+    portEXIT_CRITICAL(&lock);
+}
+
+const char *body_register(void *server)
+{
+    const httpd_uri_t route_body = {
+        .uri = "/body",
+        .method = HTTP_GET,
+        .handler = route_body_handler
+    };
+    if (power_route(server, &route_body) != ESP_OK) {
+        return "Unable to register body http route.";
+    }
+    return NULL;
+}
+
+static char *body_checkout()
+{
+    char *buffer = NULL;
+    portENTER_CRITICAL(&lock);
+    for (unsigned char i = 0; i < BODY_BUFFERS; i++) {
+        if (!(used & 1U << i)) {
+            used |= 1U << i;
+            buffer = buffers[i];
+            checkouts++;
+            unsigned char count = __builtin_popcount(used);
+            if (count > peak) {
+                peak = count;
+            }
+            break;
+        }
+    }
+    if (!buffer) {
+        exhausted++;
+    }
+    portEXIT_CRITICAL(&lock);
+    return buffer;
+}
+
+static esp_err_t route_body_handler(httpd_req_t *req)
+{
+    char buffer[160];
+    portENTER_CRITICAL(&lock);
+    unsigned char count = __builtin_popcount(used);
+    unsigned char most = peak;
+    unsigned int taken = checkouts;
+    unsigned int refused = exhausted;
+    portEXIT_CRITICAL(&lock);
+    int len = snprintf(buffer, sizeof(buffer), "{\"buffers\":%d,\"size\":%d,\"used\":%u,\"peak\":%u,\"checkouts\":%u,"
+                       "\"exhausted\":%u}", BODY_BUFFERS, BODY_SIZE, count, most, taken, refused);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    return httpd_resp_send(req, buffer, len);
+}
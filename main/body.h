@@ -0,0 +1,17 @@
+#ifndef _BODY_H
+#define _BODY_H
+
+#include <stddef.h>
+
+#include "data.h"
+
+#ifndef BODY_BUFFERS
+#define BODY_BUFFERS 1          // the setup server stops before the alarm one starts, each runs one handler at a time
+#endif
+#define BODY_SIZE (DATA_ALARMS * 384)   // the whole alarm set as json
+
+char *body_read(void *req, size_t limit);
+void body_release(char *);
+const char *body_register(void *server);
+
+#endif
@@ -1,11 +1,29 @@
-#include <time.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
 
 #include "data.h"
+#include "log.h"
+#include "zone.h"
 
 #include "nvs_flash.h"
 
+#define DATA_CONFIG offsetof(struct data, alarms)       // ssid, password and timezone
+#define DATA_LEGACY 5           // alarms in the single blob layout
+#define DATA_UNSOUND 16         // alarm size before alarms had a sound
+#define DATA_MAX(a, b) ((a) > (b) ? (a) : (b))
+#define DATA_BLOB DATA_MAX(1 + DATA_ALARMS * sizeof(struct alarm), DATA_CONFIG + DATA_LEGACY * (DATA_UNSOUND + 1))
+
 static const char namespace[] = "storage";
-static const char key[] = "data";
+static const char config_key[] = "config";
+static const char alarms_key[] = "alarms";      // entry size byte followed by the used entries
+static const char legacy_key[] = "data";
+
+// largest of the alarms, config and legacy blobs, read at boot and written from one http server at a time
+static unsigned char blob[DATA_BLOB];
+
+static const unsigned char *data_blob(nvs_handle_t, const char *, size_t *, esp_err_t *);
+static void data_entry(struct alarm *, const unsigned char *, size_t);
 
 const char *data_read(struct data *data)
 {
@@ -24,16 +42,32 @@ const char *data_read(struct data *data)
         return NULL;
     }
 
-    size_t data_size = sizeof(struct data);
-    err = nvs_get_blob(handle, key, data, &data_size);
-    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
-        return "Unable to read storage.";
+    size_t size;
+    const unsigned char *stored = data_blob(handle, config_key, &size, &err);
+    if (stored) {
+        memcpy(data, stored, size < DATA_CONFIG ? size : DATA_CONFIG);
+        if ((stored = data_blob(handle, alarms_key, &size, &err)) && size && *stored) {
+            for (size_t i = 0; i < (size - 1) / *stored && i < DATA_ALARMS; i++) {
+                data_entry(&data->alarm[i], stored + 1 + i * *stored, *stored);
+                data->alarms = i + 1;
+            }
+        }
+    } else if (err == ESP_OK && (stored = data_blob(handle, legacy_key, &size, &err))) {
+        // single blob with five slots from before the variable store, rewritten on the next save
+        size_t entry = (size - DATA_CONFIG) / DATA_LEGACY;
+        if (size > DATA_CONFIG && (entry == DATA_UNSOUND || entry == DATA_UNSOUND + 1)) {
+            memcpy(data, stored, DATA_CONFIG);
+            for (size_t i = 0; i < DATA_LEGACY && i < DATA_ALARMS; i++) {
+                data_entry(&data->alarm[i], stored + DATA_CONFIG + i * entry, entry);
+                data->alarms = i + 1;
+            }
+        }
     }
     nvs_close(handle);
-    if (*data->timezone) {
-        setenv("TZ", data->timezone, 1);
-        tzset();
+    if (err != ESP_OK) {
+        return "Unable to read storage.";
     }
+    zone_set(data->timezone);
     return NULL;
 }
 
@@ -43,12 +77,54 @@ const char *data_write(struct data *data)
     if (nvs_open(namespace, NVS_READWRITE, &handle) != ESP_OK) {
         return "Unable to open storage.";
     }
-    if (nvs_set_blob(handle, key, data, sizeof(struct data)) != ESP_OK) {
+    size_t count = data->alarms < DATA_ALARMS ? data->alarms : DATA_ALARMS;
+    *blob = sizeof(struct alarm);
+    memcpy(blob + 1, data->alarm, count * sizeof(struct alarm));
+    esp_err_t err = nvs_set_blob(handle, config_key, data, DATA_CONFIG);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(handle, alarms_key, blob, 1 + count * sizeof(struct alarm));
+    }
+    if (err != ESP_OK) {
+        nvs_close(handle);
         return "Unable to write storage.";
     }
-    if (nvs_commit(handle) != ESP_OK) {
+    err = nvs_erase_key(handle, legacy_key);
+    if ((err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) || nvs_commit(handle) != ESP_OK) {
+        nvs_close(handle);
         return "Unable to persist storage.";
     }
     nvs_close(handle);
     return NULL;
 }
+
+// Whole blob stored under key, valid until the next one is read, NULL with err ESP_OK when missing. One larger than
+// any this firmware writes, left by a newer one with larger entries, counts as missing rather than failing every boot.
+static const unsigned char *data_blob(nvs_handle_t handle, const char *key, size_t *size, esp_err_t *err)
+{
+    *size = sizeof(blob);
+    if ((*err = nvs_get_blob(handle, key, blob, size)) != ESP_OK) {
+        if (*err == ESP_ERR_NVS_INVALID_LENGTH) {
+            char message[64];
+            snprintf(message, sizeof(message), "Stored %s too large, ignored.", key);
+            log_error(message);
+            *err = ESP_OK;
+        } else if (*err == ESP_ERR_NVS_NOT_FOUND) {
+            *err = ESP_OK;
+        }
+        return NULL;
+    }
+    return blob;
+}
+
+// Entry stored with an older or newer layout, fields it lacks start at zero.
+static void data_entry(struct alarm *alarm, const unsigned char *entry, size_t size)
+{
+    memset(alarm, 0, sizeof(struct alarm));
+    if (size == DATA_UNSOUND) {
+        // stored before alarms had a sound, insert it after repeat
+        memcpy(alarm, entry, offsetof(struct alarm, sound));
+        memcpy(&alarm->volume, entry + offsetof(struct alarm, sound), DATA_UNSOUND - offsetof(struct alarm, sound));
+        return;
+    }
+    memcpy(alarm, entry, size < sizeof(struct alarm) ? size : sizeof(struct alarm));
+}
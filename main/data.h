@@ -1,11 +1,15 @@
 #ifndef _DATA_H
 #define _DATA_H
 
+#ifndef DATA_ALARMS
+#define DATA_ALARMS 32          // capacity, only used entries are stored
+#endif
+
 struct alarm {
     char hour;                  // default 7
     char minute;                // default 0
     unsigned char repeat;       // enabled bit, default 0xFF
-    // char sound;
+    unsigned char sound;        // melody, default 0
     unsigned char volume;       // default 96
     unsigned char sunrise_time; // minutes, default 5
     unsigned char sunrise_brightness;   // default 255
@@ -19,13 +23,17 @@ struct alarm {
     unsigned char pre_sleep_aid_brightness;     // default 255
     unsigned char pre_sleep_aid_fade;   // multiple 5 seconds, default 60 = 5 minutes
     unsigned char pre_sleep_aid_colour; // 2 bit rgb, default: 0x05 = blue
+    unsigned char year;         // years after 2000, 0 for weekly alarms, default 0
+    unsigned char month;        // 1 to 12 on dated alarms
+    unsigned char day;          // 1 to 31 on dated alarms
 } __attribute__((packed));
 
 struct data {
     char ssid[33];
     char password[64];
     char timezone[64];
-    struct alarm alarm[5];
+    unsigned short alarms;      // used entries
+    struct alarm alarm[DATA_ALARMS];
 } __attribute__((packed));
 
 const char *data_read(struct data *);
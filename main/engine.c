@@ -0,0 +1,124 @@
+#include <time.h>
+
+#include "engine.h"
+#include "data.h"
+#include "log.h"
+#include "light.h"
+#include "ambient.h"
+#include "schedule.h"
+#include "resume.h"
+#include "latency.h"
+#include "sound.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+
+static SemaphoreHandle_t lock = NULL;
+static struct data *alarms = NULL;      // set once the queue is built
+static struct schedule_queue queue;
+
+const char *engine_init()
+{
+    const char *err;
+    if (!(lock = xSemaphoreCreateMutex())) {
+        return "Unable to create engine mutex.";
+    }
+    if ((err = light_init())) {
+        return err;
+    }
+    if ((err = ambient_init())) {
+        return err;
+    }
+    return sound_init();
+}
+
+// Drive the outputs along the alarm phases, woken early by signal when the alarms change.
+void engine_run(struct data *data, void *wake)
+{
+    SemaphoreHandle_t signal = *(SemaphoreHandle_t *) wake;
+    struct schedule current = { 0 };
+    unsigned char level = 0;
+    time_t report = time(NULL);
+    long long target = 0;
+    engine_lock();
+    schedule_build(&queue, data, report);
+    alarms = data;
+    engine_unlock();
+    for (;;) {
+        time_t now = time(NULL);
+        struct schedule schedule;
+        engine_lock();
+        time_t wait = schedule_find(&queue, data, now, &schedule);
+        const struct alarm alarm = data->alarm[schedule.alarm];
+        engine_unlock();
+        unsigned char next = schedule_level(&schedule, now);
+        // leave manual colour untouched while idle
+        if (schedule.phase != SCHEDULE_IDLE || current.phase != SCHEDULE_IDLE) {
+            if (next != level || schedule.colour != current.colour || schedule.phase != current.phase) {
+                if (schedule.phase == SCHEDULE_SUNRISE) {
+                    light_sunrise(next);
+                } else {
+                    light_set(schedule.colour, next);
+                }
+                if (target) {
+                    latency_record(LATENCY_LIGHT, target);
+                }
+            }
+        }
+        if (schedule.phase == SCHEDULE_RING && current.phase != SCHEDULE_RING) {
+            const char *err;
+            if ((err = sound_start(alarm.sound, alarm.volume, schedule.duration, now - schedule.start))) {
+                log_error(err);
+            }
+        } else if (schedule.phase != SCHEDULE_RING && current.phase == SCHEDULE_RING) {
+            sound_stop();
+        }
+        current = schedule;
+        level = next;
+        resume_save(&current);
+        if (now - report >= 3600) {
+            latency_log();
+            report = now;
+        }
+        // wait for the next alarm action, but allow interruption with signal in case of change
+        target = esp_timer_get_time() + wait * 1000000LL;
+        if (xSemaphoreTake(signal, pdMS_TO_TICKS(wait * 1000)) == pdTRUE) {
+            target = 0;
+        } else {
+            latency_record(LATENCY_ALARM, target);
+        }
+    }
+}
+
+// Held while the alarms are edited, the queue follows through engine_update and engine_remove.
+void engine_lock()
+{
+    xSemaphoreTake(lock, portMAX_DELAY);
+}
+
+// Alarm at index changed or was appended, ENGINE_ALL requeues every alarm.
+void engine_update(int index)
+{
+    if (!alarms) {
+        return;
+    }
+    if (index == ENGINE_ALL) {
+        schedule_build(&queue, alarms, time(NULL));
+    } else {
+        schedule_update(&queue, alarms, index, time(NULL));
+    }
+}
+
+// Alarm at index was removed, the following ones moved down.
+void engine_remove(int index)
+{
+    if (alarms) {
+        schedule_remove(&queue, alarms, index, time(NULL));
+    }
+}
+
+void engine_unlock()
+{
+    xSemaphoreGive(lock);
+}
@@ -0,0 +1,15 @@
+#ifndef _ENGINE_H
+#define _ENGINE_H
+
+#define ENGINE_ALL -1           // every alarm, after a timezone change
+
+struct data;
+
+const char *engine_init();
+void engine_run(struct data *, void *signal);
+void engine_lock();
+void engine_update(int);
+void engine_remove(int);
+void engine_unlock();
+
+#endif
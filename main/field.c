@@ -0,0 +1,35 @@
+#include <stddef.h>
+
+#include "field.h"
+#include "data.h"
+#include "synth.h"
+
+// Serialization order of the alarm fields, append only.
+const struct field field_alarm[FIELD_ALARM] = {
+    {"hour", offsetof(struct alarm, hour), 23},
+    {"minute", offsetof(struct alarm, minute), 59},
+    {"repeat", offsetof(struct alarm, repeat), 255},
+    {"sound", offsetof(struct alarm, sound), SYNTH_MELODIES - 1},
+    {"volume", offsetof(struct alarm, volume), 255},
+    {"sunrise_time", offsetof(struct alarm, sunrise_time), 255},
+    {"sunrise_brightness", offsetof(struct alarm, sunrise_brightness), 255},
+    {"ring_time", offsetof(struct alarm, ring_time), 255},
+    {"sleep_time", offsetof(struct alarm, sleep_time), 255},
+    {"sleep_aid_time", offsetof(struct alarm, sleep_aid_time), 255},
+    {"sleep_aid_brightness", offsetof(struct alarm, sleep_aid_brightness), 255},
+    {"sleep_aid_fade", offsetof(struct alarm, sleep_aid_fade), 255},
+    {"sleep_aid_colour", offsetof(struct alarm, sleep_aid_colour), 6 * 6 * 6 - 1},
+    {"pre_sleep_aid_time", offsetof(struct alarm, pre_sleep_aid_time), 255},
+    {"pre_sleep_aid_brightness", offsetof(struct alarm, pre_sleep_aid_brightness), 255},
+    {"pre_sleep_aid_fade", offsetof(struct alarm, pre_sleep_aid_fade), 255},
+    {"pre_sleep_aid_colour", offsetof(struct alarm, pre_sleep_aid_colour), 6 * 6 * 6 - 1},
+    {"year", offsetof(struct alarm, year), 255},
+    {"month", offsetof(struct alarm, month), 12},
+    {"day", offsetof(struct alarm, day), 31},
+};
+
+// Checks across fields of an alarm whose fields are each in range: a year only with a month and day.
+bool field_valid(const struct alarm *alarm)
+{
+    return !alarm->year || (alarm->month && alarm->day);
+}
@@ -0,0 +1,21 @@
+#ifndef _FIELD_H
+#define _FIELD_H
+
+#include <stdbool.h>
+
+#include "data.h"
+
+#define FIELD_ALARM 20
+#define FIELD_WEEKLY 17         // fields before dated alarms
+
+struct field {
+    const char *name;
+    unsigned char offset;       // inside struct alarm, every field is one byte
+    unsigned char max;
+} __attribute__((packed));
+
+extern const struct field field_alarm[FIELD_ALARM];
+
+bool field_valid(const struct alarm *);
+
+#endif
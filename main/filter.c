@@ -0,0 +1,71 @@
+#include <string.h>
+
+#include "filter.h"
+
+static unsigned short filter_median(const struct filter *);
+
+void filter_start(struct filter *filter)
+{
+    memset(filter, 0, sizeof(struct filter));
+}
+
+// Push 12 bit samples through decimation, median and EMA, true when the level moved on.
+bool filter_feed(struct filter *filter, const unsigned short *samples, size_t count)
+{
+    bool updated = false;
+    for (size_t i = 0; i < count; i++) {
+        filter->sum += samples[i];
+        if (++filter->count < FILTER_DECIMATION) {
+            continue;
+        }
+        filter->window[filter->next] = filter->sum / FILTER_DECIMATION;
+        filter->next = (filter->next + 1) % FILTER_MEDIAN;
+        filter->sum = 0;
+        filter->count = 0;
+        if (filter->filled < FILTER_MEDIAN) {
+            // start on the first full window rather than climbing from dark
+            if (++filter->filled == FILTER_MEDIAN) {
+                filter->level = filter_median(filter) << 16;
+                updated = true;
+            }
+            continue;
+        }
+        int delta = ((int)filter_median(filter) << 16) - (int)filter->level;
+        filter->level += delta >> FILTER_SHIFT;
+        updated = true;
+    }
+    return updated;
+}
+
+// Filtered 12 bit level, rounded.
+unsigned short filter_level(const struct filter *filter)
+{
+    return (filter->level + 0x8000) >> 16;
+}
+
+// Q8 brightness factor of a level, linear between the dark and bright ends.
+unsigned short filter_scale(unsigned short level)
+{
+    if (level <= FILTER_DARK) {
+        return FILTER_MIN;
+    }
+    if (level >= FILTER_BRIGHT) {
+        return FILTER_MAX;
+    }
+    return FILTER_MIN + (FILTER_MAX - FILTER_MIN) * (level - FILTER_DARK) / (FILTER_BRIGHT - FILTER_DARK);
+}
+
+// Middle of the window by insertion sort, 5 values.
+static unsigned short filter_median(const struct filter *filter)
+{
+    unsigned short sorted[FILTER_MEDIAN];
+    for (int i = 0; i < FILTER_MEDIAN; i++) {
+        unsigned short value = filter->window[i];
+        int j = i;
+        for (; j > 0 && sorted[j - 1] > value; j--) {
+            sorted[j] = sorted[j - 1];
+        }
+        sorted[j] = value;
+    }
+    return sorted[FILTER_MEDIAN / 2];
+}
@@ -0,0 +1,33 @@
+#ifndef _FILTER_H
+#define _FILTER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define FILTER_RATE 1000        // ADC samples per second
+#define FILTER_DECIMATION 50    // 50 ms windows, whole periods of 100 and 120 Hz lamp flicker
+#define FILTER_MEDIAN 5
+#define FILTER_SHIFT 4          // EMA weight 1/16 at 20 Hz, 0.8 s time constant
+#define FILTER_DARK 64          // 12 bit levels of the scale range ends
+#define FILTER_BRIGHT 2048
+#define FILTER_UNIT 256         // Q8 scale of unchanged brightness
+#define FILTER_MIN 96
+#define FILTER_MAX 384
+#define FILTER_PERIOD 1000      // milliseconds between applied scales at least
+#define FILTER_STEP 4           // Q8 scale change worth applying
+
+struct filter {
+    unsigned int sum;           // decimation window
+    unsigned char count;
+    unsigned short window[FILTER_MEDIAN];       // last decimated values, oldest replaced
+    unsigned char next;
+    unsigned char filled;
+    unsigned int level;         // Q16 EMA of the medians
+};
+
+void filter_start(struct filter *);
+bool filter_feed(struct filter *, const unsigned short *, size_t);
+unsigned short filter_level(const struct filter *);
+unsigned short filter_scale(unsigned short);
+
+#endif
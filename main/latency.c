@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <time.h>
+
+#include "latency.h"
+#include "power.h"
+#include "log.h"
+
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "esp_http_server.h"
+
+#define LATENCY_BUCKETS 24      // power of two microseconds, last one holds everything above 8 s
+#define LATENCY_WORST 4
+
+struct latency_worst {
+    unsigned int late;          // microseconds
+    unsigned char cause;
+    time_t at;
+} __attribute__((packed));
+
+struct latency_stats {
+    unsigned int count;
+    unsigned int histogram[LATENCY_BUCKETS];
+    struct latency_worst worst[LATENCY_WORST];  // sorted, largest first
+} __attribute__((packed));
+
+static struct latency_stats stats[LATENCY_TASKS];
+
+static const char *const names[LATENCY_TASKS] = { "alarm", "light" };
+
+static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+static unsigned int http = 0;
+static unsigned char causes = 0;
+
+static unsigned char latency_bucket(unsigned int);
+static unsigned int latency_percentile(enum latency_task, unsigned int);
+static const char *latency_cause_name(unsigned char);
+static esp_err_t route_latency_handler(httpd_req_t *);
+
+void latency_cause(enum latency_cause cause, bool active)
+{
+    portENTER_CRITICAL(&lock);
+    if (cause == LATENCY_HTTP) {
+        // several handlers may run on different servers at once
+        http += active ? 1 : -1;
+        active = http > 0;
+    }
+    if (active) {
+        causes |= cause;
+    } else {
+        causes &= ~cause;
+    }
+    portEXIT_CRITICAL(&lock);
+}
+
+// Account the gap between the intended time, in esp_timer microseconds, and now.
+void latency_record(enum latency_task task, long long target)
+{
+    long long now = esp_timer_get_time();
+    unsigned int late = now > target ? (now - target > 0xFFFFFFFF ? 0xFFFFFFFF : now - target) : 0;
+    unsigned char bucket = latency_bucket(late);
+    // newlib locks inside time(), not allowed with interrupts masked
+    time_t at = time(NULL);
+    portENTER_CRITICAL(&lock);
+    stats[task].count++;
+    stats[task].histogram[bucket]++;
+    for (unsigned char i = 0; i < LATENCY_WORST; i++) {
+        if (late > stats[task].worst[i].late) {
+            for (unsigned char j = LATENCY_WORST - 1; j > i; j--) {
+                stats[task].worst[j] = stats[task].worst[j - 1];
+            }
+            stats[task].worst[i].late = late;
+            stats[task].worst[i].cause = causes;
+            stats[task].worst[i].at = at;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&lock);
+}
+
+void latency_log()
+{
+    char message[128];
+    for (unsigned char task = 0; task < LATENCY_TASKS; task++) {
+        portENTER_CRITICAL(&lock);
+        unsigned int count = stats[task].count;
+        struct latency_worst worst = stats[task].worst[0];
+        portEXIT_CRITICAL(&lock);
+        snprintf(message, sizeof(message), "Latency %s: %u samples, p50 < %u us, p99 < %u us, worst %u us (%s).",
+                 names[task], count, latency_percentile(task, 50), latency_percentile(task, 99), worst.late,
+                 latency_cause_name(worst.cause));
+        log_info(message);
+    }
+}
+
+const char *latency_register(void *server)
+{
+    const httpd_uri_t route_latency = {
+        .uri = "/latency",
+        .method = HTTP_GET,
+        .handler = route_latency_handler
+    };
+    if (power_route(server, &route_latency) != ESP_OK) {
+        return "Unable to register latency http route.";
+    }
+    return NULL;
+}
+
+static unsigned char latency_bucket(unsigned int late)
+{
+    unsigned char bucket = 0;
+    while (late > 1 && bucket < LATENCY_BUCKETS - 1) {
+        late >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+// Upper bound of the bucket holding the percentile, histogram resolution is a power of two.
+static unsigned int latency_percentile(enum latency_task task, unsigned int percentile)
+{
+    portENTER_CRITICAL(&lock);
+    unsigned long long wanted = (unsigned long long)stats[task].count * percentile;
+    unsigned long long seen = 0;
+    unsigned char bucket = 0;
+    for (; bucket < LATENCY_BUCKETS - 1; bucket++) {
+        seen += stats[task].histogram[bucket] * 100ULL;
+        if (seen >= wanted) {
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&lock);
+    return 2U << bucket;
+}
+
+static const char *latency_cause_name(unsigned char cause)
+{
+    switch (cause & (LATENCY_HTTP | LATENCY_WIFI)) {
+    case LATENCY_HTTP:
+        return "http";
+    case LATENCY_WIFI:
+        return "wifi";
+    case LATENCY_HTTP | LATENCY_WIFI:
+        return "http+wifi";
+    default:
+        return "none";
+    }
+}
+
+static esp_err_t route_latency_handler(httpd_req_t *req)
+{
+    char buffer[768];
+    httpd_resp_set_type(req, "application/json");
+    for (unsigned char task = 0; task < LATENCY_TASKS; task++) {
+        portENTER_CRITICAL(&lock);
+        struct latency_stats copy = stats[task];
+        portEXIT_CRITICAL(&lock);
+        int len = snprintf(buffer, sizeof(buffer), "%c\"%s\":{\"count\":%u,\"histogram\":[", task ? ',' : '{',
+                           names[task], copy.count);
+        for (unsigned char bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+            len += snprintf(buffer + len, sizeof(buffer) - len, "%s%u", bucket ? "," : "", copy.histogram[bucket]);
+        }
+        len += snprintf(buffer + len, sizeof(buffer) - len, "],\"worst\":[");
+        for (unsigned char i = 0; i < LATENCY_WORST && copy.worst[i].late; i++) {
+            len += snprintf(buffer + len, sizeof(buffer) - len, "%s{\"us\":%u,\"cause\":\"%s\",\"at\":%lld}",
+                            i ? "," : "", copy.worst[i].late, latency_cause_name(copy.worst[i].cause),
+                            (long long)copy.worst[i].at);
+        }
+        len += snprintf(buffer + len, sizeof(buffer) - len, "]}");
+        httpd_resp_send_chunk(req, buffer, len);
+    }
+    httpd_resp_send_chunk(req, "}", 1);
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
@@ -0,0 +1,22 @@
+#ifndef _LATENCY_H
+#define _LATENCY_H
+
+#include <stdbool.h>
+
+enum latency_task {
+    LATENCY_ALARM = 0,          // alarm loop wake up
+    LATENCY_LIGHT,              // LED output applied
+    LATENCY_TASKS,
+};
+
+enum latency_cause {
+    LATENCY_HTTP = 1 << 0,      // http request in progress
+    LATENCY_WIFI = 1 << 1,      // wifi station reconnecting
+};
+
+void latency_cause(enum latency_cause, bool);
+void latency_record(enum latency_task, long long);
+void latency_log();
+const char *latency_register(void *server);
+
+#endif
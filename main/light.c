@@ -0,0 +1,217 @@
+#include <stdbool.h>
+
+#include "light.h"
+#include "schedule.h"
+#include "power.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+
+static bool ready = false;
+static SemaphoreHandle_t lock = NULL;   // output and last values, set from engine, http and ambient tasks
+static unsigned short scale = LIGHT_SCALE_UNIT;
+static bool sunrise = false;
+static unsigned char colour = 0;
+static unsigned char brightness = 0;
+
+static const char *light_output_init();
+static void light_output(bool, unsigned char, unsigned char);
+
+const char *light_init()
+{
+    if (ready) {
+        return NULL;
+    }
+    const char *err;
+    if ((err = light_output_init())) {
+        return err;
+    }
+    lock = xSemaphoreCreateMutex();
+    if (!lock) {
+        return "Unable to create LED lock.";
+    }
+    ready = true;
+    return NULL;
+}
+
+// Colour is an index on the 6 level rgb cube.
+void light_set(unsigned char value, unsigned char level)
+{
+    xSemaphoreTake(lock, portMAX_DELAY);
+    sunrise = false;
+    colour = value;
+    brightness = level;
+    light_output(sunrise, colour, LIGHT_SCALE(brightness, scale));
+    xSemaphoreGive(lock);
+}
+
+void light_sunrise(unsigned char level)
+{
+    xSemaphoreTake(lock, portMAX_DELAY);
+    sunrise = true;
+    brightness = level;
+    light_output(sunrise, colour, LIGHT_SCALE(brightness, scale));
+    xSemaphoreGive(lock);
+}
+
+// Q8 factor on every brightness, the current output follows right away.
+void light_scale(unsigned short value)
+{
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (value != scale) {
+        scale = value;
+        light_output(sunrise, colour, LIGHT_SCALE(brightness, scale));
+    }
+    xSemaphoreGive(lock);
+}
+
+#ifdef CONFIG_ALARM_LIGHT_STRIP
+
+#include "strip.h"
+
+#include "driver/spi_master.h"
+#include "esp_attr.h"
+
+#define LIGHT_LEDS CONFIG_ALARM_LIGHT_STRIP_LENGTH
+
+static const unsigned char sunrise_bottom[3] = STRIP_SUNRISE_BOTTOM;
+static const unsigned char sunrise_top[3] = STRIP_SUNRISE_TOP;
+
+static spi_device_handle_t device = NULL;
+static unsigned char frame[LIGHT_LEDS * 3];
+static DMA_ATTR unsigned char buffers[2][STRIP_SIZE(LIGHT_LEDS)];
+static spi_transaction_t transactions[2];
+static unsigned char back = 0;
+static bool sending = false;
+
+static void light_show();
+
+static const char *light_output_init()
+{
+    strip_init();
+    // only MOSI, 3 spi bits per WS2812 bit
+    spi_bus_config_t bus = {
+        .mosi_io_num = CONFIG_ALARM_LIGHT_STRIP_GPIO,
+        .miso_io_num = -1,
+        .sclk_io_num = -1,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+        .max_transfer_sz = STRIP_SIZE(LIGHT_LEDS)
+    };
+    if (spi_bus_initialize(SPI2_HOST, &bus, SPI_DMA_CH_AUTO) != ESP_OK) {
+        return "Unable to setup LED strip bus.";
+    }
+    spi_device_interface_config_t config = {
+        .clock_speed_hz = STRIP_RATE,
+        .mode = 0,
+        .spics_io_num = -1,
+        .queue_size = 1
+    };
+    if (spi_bus_add_device(SPI2_HOST, &config, &device) != ESP_OK) {
+        return "Unable to setup LED strip device.";
+    }
+    // the LEDs power up with whatever is in their latches
+    light_show();
+    return NULL;
+}
+
+// The whole strip in the colour, or the sunrise climbing it.
+static void light_output(bool rise, unsigned char value, unsigned char level)
+{
+    if (rise) {
+        strip_rise(frame, LIGHT_LEDS, sunrise_bottom, sunrise_top, level);
+    } else {
+        unsigned char rgb[3];
+        strip_colour(value, rgb);
+        strip_fill(frame, LIGHT_LEDS, rgb, level);
+    }
+    light_show();
+}
+
+// Encode into the buffer DMA is not reading, then swap once the previous frame is out: frames are never torn.
+static void light_show()
+{
+    strip_encode(frame, LIGHT_LEDS, buffers[back]);
+    if (sending) {
+        spi_transaction_t *done;
+        spi_device_get_trans_result(device, &done, portMAX_DELAY);
+    }
+    transactions[back] = (spi_transaction_t) {
+        .length = STRIP_SIZE(LIGHT_LEDS) * 8,
+        .tx_buffer = buffers[back]
+    };
+    sending = spi_device_queue_trans(device, &transactions[back], portMAX_DELAY) == ESP_OK;
+    back ^= 1;
+}
+
+#else
+
+#include "driver/ledc.h"
+
+static bool lit = false;        // any channel above zero
+
+static const char *light_output_init()
+{
+    ledc_timer_config_t ledc_timer = {
+        .speed_mode = LEDC_LOW_SPEED_MODE,
+        .duty_resolution = LEDC_TIMER_8_BIT,
+        .timer_num = LEDC_TIMER_0,
+        .freq_hz = 4000,        // 4 kHz
+        .clk_cfg = LEDC_AUTO_CLK
+    };
+    if (ledc_timer_config(&ledc_timer) != ESP_OK) {
+        return "Unable to setup LED timer.";
+    }
+    ledc_channel_config_t ledc_channel = {
+        .speed_mode = LEDC_LOW_SPEED_MODE,
+        .channel = LEDC_CHANNEL_0,
+        .timer_sel = LEDC_TIMER_0,
+        .intr_type = LEDC_INTR_DISABLE,
+        .gpio_num = 0,
+        .duty = 0,              // Set duty to 0%
+        .hpoint = 0
+    };
+    if (ledc_channel_config(&ledc_channel) != ESP_OK) {
+        return "Unable to setup LED 0 channel.";
+    }
+    ledc_channel.channel = LEDC_CHANNEL_1;
+    ledc_channel.gpio_num = 1;
+    if (ledc_channel_config(&ledc_channel) != ESP_OK) {
+        return "Unable to setup LED 1 channel.";
+    }
+    ledc_channel.channel = LEDC_CHANNEL_2;
+    ledc_channel.gpio_num = 2;
+    if (ledc_channel_config(&ledc_channel) != ESP_OK) {
+        return "Unable to setup LED 2 channel.";
+    }
+    return NULL;
+}
+
+// Channel 0 on the lowest digit, a single lamp has no height so the sunrise is its colour.
+static void light_output(bool rise, unsigned char value, unsigned char level)
+{
+    if (rise) {
+        value = SCHEDULE_SUNRISE_COLOUR;
+    }
+    unsigned int duty[3] = {
+        (value % 6) * (255 / 5) * level / 255,
+        ((value / 6) % 6) * (255 / 5) * level / 255,
+        ((value / (6 * 6)) % 6) * (255 / 5) * level / 255
+    };
+    // the timer is not clocked in light sleep, a lit output keeps the chip awake
+    if (!lit && (duty[0] || duty[1] || duty[2])) {
+        power_hold(POWER_LIGHT, lit = true);
+    }
+    ledc_set_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0, duty[0]);
+    ledc_set_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_1, duty[1]);
+    ledc_set_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_2, duty[2]);
+    ledc_update_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0);
+    ledc_update_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_1);
+    ledc_update_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_2);
+    if (lit && !duty[0] && !duty[1] && !duty[2]) {
+        power_hold(POWER_LIGHT, lit = false);
+    }
+}
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef _LIGHT_H
+#define _LIGHT_H
+
+#define LIGHT_SCALE_UNIT 256    // Q8 brightness factor leaving levels unchanged
+#define LIGHT_SCALE(level, scale) ((level) * (scale) >> 8 > 255 ? 255 : (level) * (scale) >> 8)
+
+const char *light_init();
+void light_set(unsigned char, unsigned char);
+void light_sunrise(unsigned char);
+void light_scale(unsigned short);
+
+#endif
@@ -2,12 +2,20 @@
 #include "log.h"
 #include "wifi.h"
 #include "alarm.h"
+#include "resume.h"
+#include "light.h"
+#include "ota.h"
 
 void app_main(void)
 {
-    struct data data = { 0 };
+    // off the main task stack, it lives as long as the firmware
+    static struct data data = { 0 };
+
+    log_fatal(resume_restore());
 
     log_fatal(data_read(&data));
+    log_fatal(light_init());
+    log_fatal(ota_confirm());
 
     log_fatal(wifi_driver_init());
 
@@ -17,6 +25,7 @@ void app_main(void)
             if ((err = wifi_sta_init(&data))) {
                 log_error(err);
             } else {
+                resume_trust();
                 break;
             }
         }
@@ -0,0 +1,219 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ota.h"
+#include "update.h"
+#include "power.h"
+#include "log.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_rtc_time.h"
+#include "esp_ota_ops.h"
+#include "esp_http_server.h"
+
+#define OTA_MAGIC 0x4F544131
+#define OTA_TIMEOUTS 3          // receive timeouts in a row before a stalled upload is dropped
+
+// Moment the new image was selected, to measure the switch once it confirms itself.
+static RTC_NOINIT_ATTR struct {
+    unsigned int magic;
+    unsigned long long rtc;
+} __attribute__((packed)) switched;
+
+static struct {
+    const esp_partition_t *partition;
+    esp_ota_handle_t handle;
+} target;
+
+// handlers run on the single alarm server task
+static char buffer[1436];
+
+static const char *ota_begin(void *, size_t);
+static const char *ota_write(void *, const void *, size_t);
+static const char *ota_end(void *);
+static void ota_abort(void *);
+static bool ota_hex(const char *, unsigned char *);
+static esp_err_t route_firmware_handler(httpd_req_t *);
+
+static const struct update_writer writer = {
+    .begin = ota_begin,
+    .write = ota_write,
+    .end = ota_end,
+    .abort = ota_abort,
+};
+
+const char *ota_register(void *server)
+{
+    const httpd_uri_t route_firmware = {
+        .uri = "/firmware",
+        .method = HTTP_POST,
+        .handler = route_firmware_handler
+    };
+    if (power_route(server, &route_firmware) != ESP_OK) {
+        return "Unable to register firmware http route.";
+    }
+    return NULL;
+}
+
+// Boot health check passed, keep the running image instead of rolling back on the next reset.
+const char *ota_confirm()
+{
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    esp_ota_img_states_t state;
+    if (esp_ota_get_state_partition(running, &state) != ESP_OK || state != ESP_OTA_IMG_PENDING_VERIFY) {
+        return NULL;
+    }
+    if (esp_ota_mark_app_valid_cancel_rollback() != ESP_OK) {
+        return "Unable to confirm firmware.";
+    }
+    if (switched.magic == OTA_MAGIC) {
+        char message[64];
+        snprintf(message, sizeof(message), "Firmware switched in %llu ms.",
+                 (esp_rtc_get_time_us() - switched.rtc) / 1000);
+        log_info(message);
+        switched.magic = 0;
+    }
+    return NULL;
+}
+
+static const char *ota_begin(void *context, size_t size)
+{
+    target.partition = esp_ota_get_next_update_partition(NULL);
+    if (!target.partition) {
+        return "No firmware partition to update.";
+    }
+    if (size > target.partition->size) {
+        return "Firmware image larger than partition.";
+    }
+    // erase sector by sector while writing, instead of the whole partition upfront
+    if (esp_ota_begin(target.partition, OTA_WITH_SEQUENTIAL_WRITES, &target.handle) != ESP_OK) {
+        return "Unable to start firmware update.";
+    }
+    return NULL;
+}
+
+static const char *ota_write(void *context, const void *data, size_t size)
+{
+    if (esp_ota_write(target.handle, data, size) != ESP_OK) {
+        return "Unable to write firmware.";
+    }
+    return NULL;
+}
+
+static const char *ota_end(void *context)
+{
+    if (esp_ota_end(target.handle) != ESP_OK) {
+        return "Invalid firmware image.";
+    }
+    if (esp_ota_set_boot_partition(target.partition) != ESP_OK) {
+        return "Unable to select firmware.";
+    }
+    return NULL;
+}
+
+static void ota_abort(void *context)
+{
+    esp_ota_abort(target.handle);
+}
+
+// Exactly 64 hex digits, no spaces, signs or prefix.
+static bool ota_hex(const char *hex, unsigned char *digest)
+{
+    for (int i = 0; i < 64; i++) {
+        char c = hex[i];
+        unsigned char nibble;
+        if (c >= '0' && c <= '9') {
+            nibble = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            nibble = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            nibble = c - 'A' + 10;
+        } else {
+            return false;
+        }
+        digest[i / 2] = i % 2 ? digest[i / 2] << 4 | nibble : nibble;
+    }
+    return hex[64] == 0;
+}
+
+static esp_err_t route_firmware_handler(httpd_req_t *req)
+{
+    char hex[65];
+    unsigned char expected[32];
+    // a header too long to fit is refused, not skipped
+    esp_err_t header = httpd_req_get_hdr_value_str(req, "X-Firmware-SHA256", hex, sizeof(hex));
+    bool check = header != ESP_ERR_NOT_FOUND;
+    if (check && (header != ESP_OK || !ota_hex(hex, expected))) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid X-Firmware-SHA256 header");
+        return ESP_FAIL;
+    }
+    if (!req->content_len) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing firmware image");
+        return ESP_FAIL;
+    }
+    long long start = esp_timer_get_time();
+    unsigned int heap = esp_get_free_heap_size();
+    unsigned int lowest = heap;
+    struct update update;
+    const char *err;
+    if ((err = update_begin(&update, &writer, NULL, req->content_len))) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, err);
+        return ESP_FAIL;
+    }
+    size_t left = req->content_len;
+    unsigned char timeouts = 0;
+    while (left) {
+        int received = httpd_req_recv(req, buffer, left < sizeof(buffer) ? left : sizeof(buffer));
+        if (received == HTTPD_SOCK_ERR_TIMEOUT && ++timeouts < OTA_TIMEOUTS) {
+            continue;
+        }
+        if (received == HTTPD_SOCK_ERR_TIMEOUT) {
+            update_abort(&update);
+            httpd_resp_send_err(req, HTTPD_408_REQ_TIMEOUT, "Firmware upload stalled");
+            return ESP_FAIL;
+        }
+        timeouts = 0;
+        if (received <= 0) {
+            update_abort(&update);
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to receive firmware");
+            return ESP_FAIL;
+        }
+        if ((err = update_write(&update, buffer, received))) {
+            update_abort(&update);
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, err);
+            return ESP_FAIL;
+        }
+        left -= received;
+        unsigned int available = esp_get_free_heap_size();
+        if (available < lowest) {
+            lowest = available;
+        }
+    }
+    unsigned char digest[32];
+    if ((err = update_end(&update, check ? expected : NULL, digest))) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, err);
+        return ESP_FAIL;
+    }
+    long long elapsed = esp_timer_get_time() - start;
+    for (int i = 0; i < 32; i++) {
+        snprintf(hex + i * 2, 3, "%02x", digest[i]);
+    }
+    snprintf(buffer, sizeof(buffer),
+             "{\"bytes\":%u,\"ms\":%lld,\"kbps\":%lld,\"heap_peak\":%u,\"sha256\":\"%s\"}",
+             (unsigned int)update.written, elapsed / 1000, elapsed ? update.written * 8000LL / elapsed : 0,
+             heap - lowest, hex);
+    log_info(buffer);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, buffer);
+    switched.magic = OTA_MAGIC;
+    switched.rtc = esp_rtc_get_time_us();
+    // let the response leave before restarting into the new image
+    vTaskDelay(pdMS_TO_TICKS(500));
+    esp_restart();
+    return ESP_OK;
+}
@@ -0,0 +1,7 @@
+#ifndef _OTA_H
+#define _OTA_H
+
+const char *ota_register(void *server);
+const char *ota_confirm();
+
+#endif
@@ -0,0 +1,188 @@
+#include <stdio.h>
+
+#include "power.h"
+#include "latency.h"
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_http_server.h"
+
+#ifdef CONFIG_ALARM_POWER_SAVE
+#include "esp_pm.h"
+#endif
+
+struct power_stats {
+    unsigned int count;         // acquisitions
+    unsigned int depth;         // http handlers may run on several servers at once
+    long long held;             // microseconds, finished holds
+    long long since;            // esp_timer microseconds of the current hold
+} __attribute__((packed));
+
+static struct power_stats stats[POWER_HOLDERS];
+
+static const char *const names[POWER_HOLDERS] = { "light", "ring", "http" };
+
+static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+static unsigned char holding = 0;       // holders with a hold
+static long long held = 0;      // microseconds with any hold, finished ones
+static long long since = 0;
+static long long slept = 0;     // microseconds in light sleep
+static unsigned int sleeps = 0;
+
+#ifdef CONFIG_ALARM_POWER_SAVE
+static esp_pm_lock_handle_t locks[POWER_HOLDERS];
+static bool ready = false;
+
+static esp_err_t power_woke(int64_t, void *);
+#endif
+static esp_err_t power_request(httpd_req_t *);
+static esp_err_t route_power_handler(httpd_req_t *);
+
+// Light sleep whenever nothing holds the chip awake, at the configured frequency so PWM and I2S clocks never move.
+const char *power_init()
+{
+#ifdef CONFIG_ALARM_POWER_SAVE
+    if (ready) {
+        return NULL;
+    }
+    for (unsigned char i = 0; i < POWER_HOLDERS; i++) {
+        if (esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, names[i], &locks[i]) != ESP_OK) {
+            return "Unable to create power lock.";
+        }
+    }
+    // holds taken before the locks existed
+    portENTER_CRITICAL(&lock);
+    for (unsigned char i = 0; i < POWER_HOLDERS; i++) {
+        if (stats[i].depth) {
+            esp_pm_lock_acquire(locks[i]);
+        }
+    }
+    ready = true;
+    portEXIT_CRITICAL(&lock);
+    esp_pm_sleep_cbs_register_config_t callbacks = {
+        .exit_cb = power_woke
+    };
+    if (esp_pm_light_sleep_register_cbs(&callbacks) != ESP_OK) {
+        return "Unable to register light sleep callback.";
+    }
+    esp_pm_config_t config = {
+        .max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .min_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .light_sleep_enable = true
+    };
+    if (esp_pm_configure(&config) != ESP_OK) {
+        return "Unable to configure power management.";
+    }
+#endif
+    return NULL;
+}
+
+// Keep the chip out of light sleep while active, accounted per holder.
+void power_hold(enum power_holder holder, bool active)
+{
+    long long now = esp_timer_get_time();
+    portENTER_CRITICAL(&lock);
+    struct power_stats *stat = &stats[holder];
+    if (active ? stat->depth++ > 0 : !stat->depth || --stat->depth > 0) {
+        // nested, or released without a hold
+        portEXIT_CRITICAL(&lock);
+        return;
+    }
+    if (active) {
+        stat->count++;
+        stat->since = now;
+        if (!holding++) {
+            since = now;
+        }
+    } else {
+        stat->held += now - stat->since;
+        if (!--holding) {
+            held += now - since;
+        }
+    }
+#ifdef CONFIG_ALARM_POWER_SAVE
+    if (ready) {
+        if (active) {
+            esp_pm_lock_acquire(locks[holder]);
+        } else {
+            esp_pm_lock_release(locks[holder]);
+        }
+    }
+#endif
+    portEXIT_CRITICAL(&lock);
+}
+
+// Register an httpd_uri_t whose handler runs under the http hold, kept out of light sleep and counted as the cause of
+// late wake ups, a chunked response as much as a posted body.
+esp_err_t power_route(void *server, const void *uri)
+{
+    httpd_uri_t route = *(const httpd_uri_t *)uri;
+    route.user_ctx = route.handler;
+    route.handler = power_request;
+    return httpd_register_uri_handler(server, &route);
+}
+
+const char *power_register(void *server)
+{
+    const httpd_uri_t route_power = {
+        .uri = "/power",
+        .method = HTTP_GET,
+        .handler = route_power_handler
+    };
+    if (power_route(server, &route_power) != ESP_OK) {
+        return "Unable to register power http route.";
+    }
+    return NULL;
+}
+
+#ifdef CONFIG_ALARM_POWER_SAVE
+// Called by the idle task with interrupts off once back from light sleep.
+static esp_err_t IRAM_ATTR power_woke(int64_t duration, void *arg)
+{
+    slept += duration;
+    sleeps++;
+    return ESP_OK;
+}
+#endif
+
+static esp_err_t power_request(httpd_req_t *req)
+{
+    latency_cause(LATENCY_HTTP, true);
+    power_hold(POWER_HTTP, true);
+    esp_err_t err = ((esp_err_t (*)(httpd_req_t *))req->user_ctx)(req);
+    power_hold(POWER_HTTP, false);
+    latency_cause(LATENCY_HTTP, false);
+    return err;
+}
+
+static esp_err_t route_power_handler(httpd_req_t *req)
+{
+    char buffer[512];
+    long long now = esp_timer_get_time();
+    portENTER_CRITICAL(&lock);
+    struct power_stats copy[POWER_HOLDERS];
+    for (unsigned char i = 0; i < POWER_HOLDERS; i++) {
+        copy[i] = stats[i];
+        if (copy[i].depth) {
+            copy[i].held += now - copy[i].since;
+        }
+    }
+    long long asleep = slept;
+    long long locked = held + (holding ? now - since : 0);
+    unsigned int count = sleeps;
+    portEXIT_CRITICAL(&lock);
+    // awake time is split between held by some holder and idle without being allowed to sleep
+    int len = snprintf(buffer, sizeof(buffer), "{\"uptime_us\":%lld,\"states\":{\"sleep_us\":%lld,\"idle_us\":%lld,"
+                       "\"held_us\":%lld},\"sleeps\":%u,\"holders\":{", now, asleep, now - asleep - locked, locked,
+                       count);
+    for (unsigned char i = 0; i < POWER_HOLDERS; i++) {
+        len += snprintf(buffer + len, sizeof(buffer) - len, "%s\"%s\":{\"count\":%u,\"held_us\":%lld,\"active\":%s}",
+                        i ? "," : "", names[i], copy[i].count, copy[i].held, copy[i].depth ? "true" : "false");
+    }
+    len += snprintf(buffer + len, sizeof(buffer) - len, "}}");
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    return httpd_resp_send(req, buffer, len);
+}
@@ -0,0 +1,20 @@
+#ifndef _POWER_H
+#define _POWER_H
+
+#include <stdbool.h>
+
+#include "esp_err.h"
+
+enum power_holder {
+    POWER_LIGHT = 0,            // PWM output lit, LEDC stops in light sleep
+    POWER_RING,                 // ring tone on I2S
+    POWER_HTTP,                 // http request in progress
+    POWER_HOLDERS,
+};
+
+const char *power_init();
+void power_hold(enum power_holder, bool);
+const char *power_register(void *server);
+esp_err_t power_route(void *server, const void *uri);
+
+#endif
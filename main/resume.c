@@ -0,0 +1,122 @@
+#include <stdbool.h>
+#include <sys/time.h>
+
+#include "resume.h"
+#include "schedule.h"
+#include "light.h"
+
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_rtc_time.h"
+#include "esp_rom_crc.h"
+
+#define RESUME_MAGIC 0x414C524D
+
+// Survives every reset but power on and brownout, validated by magic and checksum.
+static RTC_NOINIT_ATTR struct {
+    unsigned int magic;
+    struct schedule schedule;
+    long long epoch;            // trusted wall clock in microseconds when saved
+    unsigned long long rtc;     // RTC timer in microseconds when saved
+    unsigned int crc;
+} __attribute__((packed)) state;
+
+static bool trusted = false;
+static esp_timer_handle_t timer = NULL;
+
+static unsigned int resume_crc();
+static void resume_update(void *);
+
+// Called before any networking, puts the output back on the curve of an interrupted phase.
+const char *resume_restore()
+{
+    esp_reset_reason_t reason = esp_reset_reason();
+    if (reason == ESP_RST_POWERON || reason == ESP_RST_BROWNOUT || reason == ESP_RST_UNKNOWN ||
+        state.magic != RESUME_MAGIC || state.crc != resume_crc()) {
+        state.magic = 0;
+        return NULL;
+    }
+    unsigned long long rtc = esp_rtc_get_time_us();
+    if (rtc < state.rtc) {
+        state.magic = 0;
+        return NULL;
+    }
+    long long now = state.epoch + (long long)(rtc - state.rtc);
+    struct timeval tv = {
+        .tv_sec = now / 1000000,
+        .tv_usec = now % 1000000
+    };
+    if (settimeofday(&tv, NULL)) {
+        return "Unable to restore clock.";
+    }
+    trusted = true;
+    if (state.schedule.phase == SCHEDULE_IDLE || tv.tv_sec >= state.schedule.start + state.schedule.duration) {
+        return NULL;
+    }
+    const char *err;
+    if ((err = light_init())) {
+        return err;
+    }
+    resume_update(NULL);
+    // keep following the curve until the alarm loop takes over
+    const esp_timer_create_args_t args = {
+        .callback = resume_update,
+        .name = "resume"
+    };
+    if (esp_timer_create(&args, &timer) != ESP_OK) {
+        return "Unable to create resume timer.";
+    }
+    if (esp_timer_start_periodic(timer, 1000000) != ESP_OK) {
+        esp_timer_delete(timer);
+        timer = NULL;
+        return "Unable to start resume timer.";
+    }
+    return NULL;
+}
+
+void resume_stop()
+{
+    if (!timer) {
+        return;
+    }
+    esp_timer_stop(timer);
+    esp_timer_delete(timer);
+    timer = NULL;
+}
+
+// Wall clock is synchronized, phases saved from now on may be restored.
+void resume_trust()
+{
+    trusted = true;
+}
+
+void resume_save(const struct schedule *schedule)
+{
+    if (!trusted) {
+        state.magic = 0;
+        return;
+    }
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    state.schedule = *schedule;
+    state.epoch = (long long)tv.tv_sec * 1000000 + tv.tv_usec;
+    state.rtc = esp_rtc_get_time_us();
+    state.magic = RESUME_MAGIC;
+    state.crc = resume_crc();
+}
+
+static unsigned int resume_crc()
+{
+    return esp_rom_crc32_le(0, (const unsigned char *)&state, sizeof(state) - sizeof(state.crc));
+}
+
+static void resume_update(void *arg)
+{
+    unsigned char level = schedule_level(&state.schedule, time(NULL));
+    if (state.schedule.phase == SCHEDULE_SUNRISE) {
+        light_sunrise(level);
+    } else {
+        light_set(state.schedule.colour, level);
+    }
+}
@@ -0,0 +1,11 @@
+#ifndef _RESUME_H
+#define _RESUME_H
+
+struct schedule;
+
+const char *resume_restore();
+void resume_stop();
+void resume_trust();
+void resume_save(const struct schedule *);
+
+#endif
@@ -0,0 +1,393 @@
+#include <limits.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "schedule.h"
+#include "data.h"
+#include "zone.h"
+
+#define SCHEDULE_MAX_WAIT 3600
+#define SCHEDULE_NONE 0xFFFF    // entry position without occurrence
+#define SCHEDULE_HORIZON 372    // days searched for a weekly occurrence, a year of dates off and a week
+
+static void schedule_phases(const struct alarm *, unsigned short, time_t, struct schedule *);
+static void schedule_phase(struct schedule *, time_t *, time_t, const struct schedule *);
+static void schedule_walk(const struct schedule_queue *, const struct data *, unsigned short, time_t,
+                          struct schedule *, time_t *);
+static unsigned short schedule_over(const struct schedule_queue *, unsigned short, time_t);
+static void schedule_occurrence(struct schedule_queue *, const struct data *, unsigned short, time_t,
+                                const struct tm *);
+static int schedule_dates(struct schedule_queue *, const struct data *);
+static void schedule_revisit(struct schedule_queue *, const struct data *, int, time_t, const struct tm *);
+static bool schedule_off(const struct schedule_queue *, int);
+static void schedule_link(struct schedule_queue *, unsigned short);
+static void schedule_unlink(struct schedule_queue *, unsigned short);
+static void schedule_sift(struct schedule_queue *, unsigned short);
+
+// Fill the highest priority phase active at now, returns seconds until the output may change.
+time_t schedule_find(struct schedule_queue *queue, const struct data *data, time_t now, struct schedule *schedule)
+{
+    time_t next = now + SCHEDULE_MAX_WAIT;
+    memset(schedule, 0, sizeof(struct schedule));
+    if (now < queue->now) {
+        schedule_build(queue, data, now);
+    }
+    queue->now = now;
+    // move finished occurrences to their next one, only started entries are visited
+    unsigned short over = schedule_over(queue, 0, now);
+    if (over != SCHEDULE_NONE) {
+        struct tm today;
+        zone_local(now, &today);
+        do {
+            schedule_occurrence(queue, data, over, now, &today);
+        } while ((over = schedule_over(queue, 0, now)) != SCHEDULE_NONE);
+    }
+    schedule_walk(queue, data, 0, now, schedule, &next);
+    if (schedule->phase == SCHEDULE_SUNRISE ||
+        (schedule->phase != SCHEDULE_IDLE && now >= schedule->start + schedule->duration - schedule->fade)) {
+        return 1;
+    }
+    return next - now;
+}
+
+// Start of the earliest pending occurrence, 0 without any.
+time_t schedule_next(const struct schedule_queue *queue)
+{
+    return queue->count ? queue->entry[queue->heap[0]].begin : 0;
+}
+
+void schedule_build(struct schedule_queue *queue, const struct data *data, time_t now)
+{
+    memset(queue, 0, sizeof(struct schedule_queue));
+    for (unsigned short i = 0; i < DATA_ALARMS; i++) {
+        queue->entry[i].position = SCHEDULE_NONE;
+    }
+    queue->now = now;
+    struct tm today;
+    zone_local(now, &today);
+    schedule_dates(queue, data);
+    for (unsigned short i = 0; i < data->alarms && i < DATA_ALARMS; i++) {
+        schedule_occurrence(queue, data, i, now, &today);
+    }
+}
+
+// Alarm at index changed or was appended, weekly alarms are only revisited when the dates off changed.
+void schedule_update(struct schedule_queue *queue, const struct data *data, unsigned short index, time_t now)
+{
+    if (index >= data->alarms || index >= DATA_ALARMS) {
+        return;
+    }
+    struct tm today;
+    zone_local(now, &today);
+    schedule_revisit(queue, data, schedule_dates(queue, data), now, &today);
+    schedule_occurrence(queue, data, index, now, &today);
+}
+
+// Alarm at index was removed and the following ones already moved down.
+void schedule_remove(struct schedule_queue *queue, const struct data *data, unsigned short index, time_t now)
+{
+    if (index > data->alarms || index >= DATA_ALARMS) {
+        return;
+    }
+    schedule_unlink(queue, index);
+    memmove(&queue->entry[index], &queue->entry[index + 1], (data->alarms - index) * sizeof(*queue->entry));
+    queue->entry[data->alarms].position = SCHEDULE_NONE;
+    for (unsigned short i = 0; i < queue->count; i++) {
+        if (queue->heap[i] > index) {
+            queue->heap[i]--;
+        }
+    }
+    struct tm today;
+    zone_local(now, &today);
+    schedule_revisit(queue, data, schedule_dates(queue, data), now, &today);
+}
+
+// Output brightness of the phase curve at now.
+unsigned char schedule_level(const struct schedule *schedule, time_t now)
+{
+    if (schedule->phase == SCHEDULE_IDLE || now < schedule->start || now >= schedule->start + schedule->duration) {
+        return 0;
+    }
+    unsigned int elapsed = now - schedule->start;
+    if (schedule->phase == SCHEDULE_SUNRISE) {
+        return schedule->brightness * elapsed / schedule->duration;
+    }
+    unsigned int left = schedule->duration - elapsed;
+    if (left < schedule->fade) {
+        return schedule->brightness * left / schedule->fade;
+    }
+    return schedule->brightness;
+}
+
+// The four phases of the occurrence waking at wake, by decreasing priority.
+static void schedule_phases(const struct alarm *alarm, unsigned short index, time_t wake, struct schedule *phases)
+{
+    time_t bed = wake - alarm->sleep_time * 300;
+    phases[0] = (struct schedule) {
+        .phase = SCHEDULE_RING,
+        .alarm = index,
+        .start = wake,
+        .duration = alarm->ring_time * 60,
+        .colour = SCHEDULE_SUNRISE_COLOUR,
+        .brightness = alarm->sunrise_brightness
+    };
+    phases[1] = phases[0];
+    phases[1].phase = SCHEDULE_SUNRISE;
+    phases[1].start = wake - alarm->sunrise_time * 60;
+    phases[1].duration = alarm->sunrise_time * 60;
+    phases[2] = (struct schedule) {
+        .phase = SCHEDULE_SLEEP_AID,
+        .alarm = index,
+        .start = bed,
+        .duration = alarm->sleep_aid_time * 60,
+        .fade = alarm->sleep_aid_fade * 5,
+        .colour = alarm->sleep_aid_colour,
+        .brightness = alarm->sleep_aid_brightness
+    };
+    phases[3] = (struct schedule) {
+        .phase = SCHEDULE_PRE_SLEEP_AID,
+        .alarm = index,
+        .start = bed - alarm->pre_sleep_aid_time * 60,
+        .duration = alarm->pre_sleep_aid_time * 60,
+        .fade = alarm->pre_sleep_aid_fade * 5,
+        .colour = alarm->pre_sleep_aid_colour,
+        .brightness = alarm->pre_sleep_aid_brightness
+    };
+}
+
+static void schedule_phase(struct schedule *schedule, time_t *next, time_t now, const struct schedule *candidate)
+{
+    if (!candidate->duration) {
+        return;
+    }
+    time_t end = candidate->start + candidate->duration;
+    if (candidate->start > now) {
+        if (candidate->start < *next) {
+            *next = candidate->start;
+        }
+        return;
+    }
+    if (end <= now) {
+        return;
+    }
+    if (end < *next) {
+        *next = end;
+    }
+    if (candidate->fade && end - candidate->fade > now && end - candidate->fade < *next) {
+        *next = end - candidate->fade;
+    }
+    // the lowest alarm wins between equal phases
+    if (candidate->phase > schedule->phase ||
+        (candidate->phase == schedule->phase && candidate->alarm < schedule->alarm)) {
+        *schedule = *candidate;
+    }
+}
+
+// Evaluate the started occurrences under position, the ones not started only bound next.
+static void schedule_walk(const struct schedule_queue *queue, const struct data *data, unsigned short position,
+                          time_t now, struct schedule *schedule, time_t *next)
+{
+    if (position >= queue->count) {
+        return;
+    }
+    unsigned short index = queue->heap[position];
+    if (queue->entry[index].begin > now) {
+        if (queue->entry[index].begin < *next) {
+            *next = queue->entry[index].begin;
+        }
+        return;
+    }
+    struct schedule phases[4];
+    schedule_phases(&data->alarm[index], index, queue->entry[index].wake, phases);
+    for (unsigned char i = 0; i < sizeof(phases) / sizeof(*phases); i++) {
+        schedule_phase(schedule, next, now, &phases[i]);
+    }
+    schedule_walk(queue, data, position * 2 + 1, now, schedule, next);
+    schedule_walk(queue, data, position * 2 + 2, now, schedule, next);
+}
+
+// Started occurrence under position which is over at now, SCHEDULE_NONE without.
+static unsigned short schedule_over(const struct schedule_queue *queue, unsigned short position, time_t now)
+{
+    if (position >= queue->count || queue->entry[queue->heap[position]].begin > now) {
+        return SCHEDULE_NONE;
+    }
+    if (queue->entry[queue->heap[position]].end <= now) {
+        return queue->heap[position];
+    }
+    unsigned short over = schedule_over(queue, position * 2 + 1, now);
+    return over != SCHEDULE_NONE ? over : schedule_over(queue, position * 2 + 2, now);
+}
+
+// Queue the first occurrence of the alarm at index not over at now.
+static void schedule_occurrence(struct schedule_queue *queue, const struct data *data, unsigned short index,
+                                time_t now, const struct tm *today)
+{
+    const struct alarm *alarm = &data->alarm[index];
+    schedule_unlink(queue, index);
+    if (!(alarm->repeat & SCHEDULE_ENABLED) || (alarm->year && alarm->repeat & SCHEDULE_DAY_OFF) ||
+        (!alarm->year && !(alarm->repeat & ~SCHEDULE_ENABLED))) {
+        return;
+    }
+    struct schedule phases[4];
+    schedule_phases(alarm, index, 0, phases);
+    time_t from = 0, to = 0;
+    bool active = false;
+    for (unsigned char i = 0; i < sizeof(phases) / sizeof(*phases); i++) {
+        if (!phases[i].duration) {
+            continue;
+        }
+        if (!active || phases[i].start < from) {
+            from = phases[i].start;
+        }
+        if (!active || phases[i].start + phases[i].duration > to) {
+            to = phases[i].start + phases[i].duration;
+        }
+        active = true;
+    }
+    if (!active) {
+        return;
+    }
+    int current = zone_day(today->tm_year + 1900, today->tm_mon + 1, today->tm_mday);
+    // sleep period and pre sleep aid may start more than a day before the wake time
+    int first = alarm->year ? zone_day(alarm->year + 2000, alarm->month, alarm->day) : current - 1;
+    int last = alarm->year ? first : first + SCHEDULE_HORIZON;
+    for (int day = first; day <= last; day++) {
+        if (!alarm->year && (!(alarm->repeat & (1 << ((day % 7 + 11) % 7))) || schedule_off(queue, day))) {
+            continue;
+        }
+        struct tm tm = *today;
+        tm.tm_mday += day - current;
+        tm.tm_hour = alarm->hour;
+        tm.tm_min = alarm->minute;
+        tm.tm_sec = 0;
+        tm.tm_isdst = -1;
+        time_t wake = zone_epoch(&tm);
+        if (wake == -1 || wake + to <= now) {
+            continue;
+        }
+        queue->entry[index].begin = wake + from;
+        queue->entry[index].end = wake + to;
+        queue->entry[index].wake = wake;
+        queue->entry[index].day = day;
+        schedule_link(queue, index);
+        return;
+    }
+}
+
+// Collect the dates off, returns the first changed one or INT_MAX.
+static int schedule_dates(struct schedule_queue *queue, const struct data *data)
+{
+    int off[DATA_ALARMS];
+    unsigned short days = 0;
+    for (unsigned short i = 0; i < data->alarms && i < DATA_ALARMS; i++) {
+        const struct alarm *alarm = &data->alarm[i];
+        if (!alarm->year || (alarm->repeat & (SCHEDULE_ENABLED | SCHEDULE_DAY_OFF)) !=
+            (SCHEDULE_ENABLED | SCHEDULE_DAY_OFF)) {
+            continue;
+        }
+        int day = zone_day(alarm->year + 2000, alarm->month, alarm->day);
+        unsigned short j = days;
+        while (j && off[j - 1] > day) {
+            j--;
+        }
+        if (j && off[j - 1] == day) {
+            continue;
+        }
+        memmove(&off[j + 1], &off[j], (days - j) * sizeof(*off));
+        off[j] = day;
+        days++;
+    }
+    unsigned short i = 0, j = 0;
+    while (i < queue->days && j < days && queue->off[i] == off[j]) {
+        i++;
+        j++;
+    }
+    int changed = i < queue->days ? queue->off[i] : INT_MAX;
+    if (j < days && off[j] < changed) {
+        changed = off[j];
+    }
+    memcpy(queue->off, off, days * sizeof(*off));
+    queue->days = days;
+    return changed;
+}
+
+// Weekly alarms waking on or after the changed date off look for their occurrence again.
+static void schedule_revisit(struct schedule_queue *queue, const struct data *data, int changed, time_t now,
+                             const struct tm *today)
+{
+    if (changed == INT_MAX) {
+        return;
+    }
+    for (unsigned short i = 0; i < data->alarms && i < DATA_ALARMS; i++) {
+        if (!data->alarm[i].year &&
+            (queue->entry[i].position == SCHEDULE_NONE || queue->entry[i].day >= changed)) {
+            schedule_occurrence(queue, data, i, now, today);
+        }
+    }
+}
+
+static bool schedule_off(const struct schedule_queue *queue, int day)
+{
+    unsigned short low = 0, high = queue->days;
+    while (low < high) {
+        unsigned short middle = (low + high) / 2;
+        if (queue->off[middle] < day) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low < queue->days && queue->off[low] == day;
+}
+
+static void schedule_link(struct schedule_queue *queue, unsigned short index)
+{
+    queue->heap[queue->count] = index;
+    queue->entry[index].position = queue->count++;
+    schedule_sift(queue, queue->entry[index].position);
+}
+
+static void schedule_unlink(struct schedule_queue *queue, unsigned short index)
+{
+    unsigned short position = queue->entry[index].position;
+    if (position == SCHEDULE_NONE) {
+        return;
+    }
+    queue->entry[index].position = SCHEDULE_NONE;
+    if (position != --queue->count) {
+        queue->heap[position] = queue->heap[queue->count];
+        queue->entry[queue->heap[position]].position = position;
+        schedule_sift(queue, position);
+    }
+}
+
+// Restore the heap order around position after its begin changed.
+static void schedule_sift(struct schedule_queue *queue, unsigned short position)
+{
+    unsigned short index = queue->heap[position];
+    time_t begin = queue->entry[index].begin;
+    while (position && queue->entry[queue->heap[(position - 1) / 2]].begin > begin) {
+        queue->heap[position] = queue->heap[(position - 1) / 2];
+        queue->entry[queue->heap[position]].position = position;
+        position = (position - 1) / 2;
+    }
+    for (;;) {
+        unsigned short child = position * 2 + 1;
+        if (child >= queue->count) {
+            break;
+        }
+        if (child + 1 < queue->count &&
+            queue->entry[queue->heap[child + 1]].begin < queue->entry[queue->heap[child]].begin) {
+            child++;
+        }
+        if (queue->entry[queue->heap[child]].begin >= begin) {
+            break;
+        }
+        queue->heap[position] = queue->heap[child];
+        queue->entry[queue->heap[position]].position = position;
+        position = child;
+    }
+    queue->heap[position] = index;
+    queue->entry[index].position = position;
+}
@@ -0,0 +1,53 @@
+#ifndef _SCHEDULE_H
+#define _SCHEDULE_H
+
+#include <time.h>
+
+#include "data.h"
+
+#define SCHEDULE_ENABLED 0x80   // repeat bit, lower 7 bits are tm_wday of the wake day
+#define SCHEDULE_DAY_OFF 0x01   // repeat bit of dated alarms, no weekly alarm wakes on that date
+#define SCHEDULE_SUNRISE_COLOUR 199     // warm white on the 6 level cube
+
+enum schedule_phase {
+    SCHEDULE_IDLE = 0,
+    SCHEDULE_PRE_SLEEP_AID,
+    SCHEDULE_SLEEP_AID,
+    SCHEDULE_SUNRISE,
+    SCHEDULE_RING,
+};
+
+struct schedule {
+    unsigned char phase;
+    unsigned short alarm;       // index of the alarm driving the phase
+    time_t start;               // epoch seconds
+    unsigned short duration;    // seconds
+    unsigned short fade;        // seconds, fade out at the end of the phase
+    unsigned char colour;       // 6 level rgb cube index
+    unsigned char brightness;
+} __attribute__((packed));
+
+// Upcoming occurrence of every alarm in a min heap on its first phase start, one occurrence per alarm at a time.
+struct schedule_queue {
+    time_t now;                 // latest lookup, a clock going back rebuilds
+    unsigned short count;       // alarms with an occurrence
+    unsigned short heap[DATA_ALARMS];
+    struct {
+        time_t begin;           // start of the first phase
+        time_t end;             // end of the last phase
+        time_t wake;
+        int day;                // days since epoch of the wake day
+        unsigned short position;        // in heap, SCHEDULE_NONE without occurrence
+    } entry[DATA_ALARMS];
+    unsigned short days;        // dates off
+    int off[DATA_ALARMS];       // days since epoch, sorted
+};
+
+time_t schedule_find(struct schedule_queue *, const struct data *, time_t, struct schedule *);
+time_t schedule_next(const struct schedule_queue *);
+void schedule_build(struct schedule_queue *, const struct data *, time_t);
+void schedule_update(struct schedule_queue *, const struct data *, unsigned short, time_t);
+void schedule_remove(struct schedule_queue *, const struct data *, unsigned short, time_t);
+unsigned char schedule_level(const struct schedule *, time_t);
+
+#endif
@@ -1,6 +1,7 @@
 #include "setup.h"
 #include "data.h"
 #include "form.h"
+#include "body.h"
 
 #include "esp_http_server.h"
 #include "esp_event.h"
@@ -67,27 +68,10 @@ static esp_err_t route_home_handler(httpd_req_t *req)
 
 static esp_err_t route_setup_handler(httpd_req_t *req)
 {
-    size_t total = req->content_len;
-    if (total > 4096) {
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "content too long");
-        return ESP_FAIL;
-    }
-    char *buffer = malloc(total + 1);
+    char *buffer = body_read(req, 4096);
     if (!buffer) {
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "no memory");
         return ESP_FAIL;
     }
-    size_t cur_len = 0;
-    while (cur_len < total) {
-        size_t received = httpd_req_recv(req, buffer + cur_len, total - cur_len);
-        if (received <= 0) {
-            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to post control value");
-            free(buffer);
-            return ESP_FAIL;
-        }
-        cur_len += received;
-    }
-    buffer[total] = 0;
     struct form_data form_data[3] = {
         {
          .key = "ssid",
@@ -108,8 +92,8 @@ static esp_err_t route_setup_handler(httpd_req_t *req)
          .value_len = sizeof(((struct data *) NULL)->timezone)
          }
     };
-    form_parse(buffer, total, form_data, 3);
-    free(buffer);
+    form_parse(buffer, req->content_len, form_data, 3);
+    body_release(buffer);
     httpd_resp_sendstr(req, "Setup completed");
     xSemaphoreGive(context.signal);
     return ESP_OK;
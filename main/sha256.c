@@ -0,0 +1,105 @@
+#include <string.h>
+
+#include "sha256.h"
+
+#define SHA256_ROTR(x, n) ((x) >> (n) | (x) << (32 - (n)))
+
+static const unsigned int k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static void sha256_block(struct sha256 *, const unsigned char *);
+
+void sha256_init(struct sha256 *sha256)
+{
+    static const unsigned int initial[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(sha256->state, initial, sizeof(initial));
+    sha256->length = 0;
+}
+
+void sha256_update(struct sha256 *sha256, const void *data, size_t size)
+{
+    const unsigned char *bytes = data;
+    size_t used = sha256->length % 64;
+    sha256->length += size;
+    if (used) {
+        size_t fill = 64 - used < size ? 64 - used : size;
+        memcpy(sha256->block + used, bytes, fill);
+        bytes += fill;
+        size -= fill;
+        if (used + fill < 64) {
+            return;
+        }
+        sha256_block(sha256, sha256->block);
+    }
+    // whole blocks are hashed in place, without a copy
+    for (; size >= 64; bytes += 64, size -= 64) {
+        sha256_block(sha256, bytes);
+    }
+    memcpy(sha256->block, bytes, size);
+}
+
+void sha256_final(struct sha256 *sha256, unsigned char *digest)
+{
+    unsigned long long bits = sha256->length * 8;
+    size_t used = sha256->length % 64;
+    sha256->block[used++] = 0x80;
+    if (used > 56) {
+        memset(sha256->block + used, 0, 64 - used);
+        sha256_block(sha256, sha256->block);
+        used = 0;
+    }
+    memset(sha256->block + used, 0, 56 - used);
+    for (int i = 0; i < 8; i++) {
+        sha256->block[63 - i] = bits >> (i * 8);
+    }
+    sha256_block(sha256, sha256->block);
+    for (int i = 0; i < 32; i++) {
+        digest[i] = sha256->state[i / 4] >> (24 - i % 4 * 8);
+    }
+}
+
+static void sha256_block(struct sha256 *sha256, const unsigned char *block)
+{
+    unsigned int w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (unsigned int)block[i * 4] << 24 | block[i * 4 + 1] << 16 | block[i * 4 + 2] << 8 | block[i * 4 + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        unsigned int s0 = SHA256_ROTR(w[i - 15], 7) ^ SHA256_ROTR(w[i - 15], 18) ^ w[i - 15] >> 3;
+        unsigned int s1 = SHA256_ROTR(w[i - 2], 17) ^ SHA256_ROTR(w[i - 2], 19) ^ w[i - 2] >> 10;
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    unsigned int a = sha256->state[0], b = sha256->state[1], c = sha256->state[2], d = sha256->state[3];
+    unsigned int e = sha256->state[4], f = sha256->state[5], g = sha256->state[6], h = sha256->state[7];
+    for (int i = 0; i < 64; i++) {
+        unsigned int t1 = h + (SHA256_ROTR(e, 6) ^ SHA256_ROTR(e, 11) ^ SHA256_ROTR(e, 25)) + ((e & f) ^ (~e & g)) + k[i]
+            + w[i];
+        unsigned int t2 = (SHA256_ROTR(a, 2) ^ SHA256_ROTR(a, 13) ^ SHA256_ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    sha256->state[0] += a;
+    sha256->state[1] += b;
+    sha256->state[2] += c;
+    sha256->state[3] += d;
+    sha256->state[4] += e;
+    sha256->state[5] += f;
+    sha256->state[6] += g;
+    sha256->state[7] += h;
+}
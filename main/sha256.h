@@ -0,0 +1,16 @@
+#ifndef _SHA256_H
+#define _SHA256_H
+
+#include <stddef.h>
+
+struct sha256 {
+    unsigned int state[8];
+    unsigned long long length;  // bytes hashed
+    unsigned char block[64];
+};
+
+void sha256_init(struct sha256 *);
+void sha256_update(struct sha256 *, const void *, size_t);
+void sha256_final(struct sha256 *, unsigned char *);
+
+#endif
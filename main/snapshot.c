@@ -0,0 +1,194 @@
+#include <string.h>
+
+#include "snapshot.h"
+#include "field.h"
+
+// Layout, integers little endian:
+//   "ACS" version:1 count:1
+//   ssid, password and timezone as length:1 bytes
+//   count alarms of FIELD_ALARM bytes each, in field_alarm order, FIELD_WEEKLY on version 1
+//   crc32 of everything above:4
+
+#define SNAPSHOT_STRINGS 3
+
+enum snapshot_state {
+    SNAPSHOT_MAGIC = 0,
+    SNAPSHOT_LENGTH,
+    SNAPSHOT_STRING,
+    SNAPSHOT_ALARM,
+    SNAPSHOT_CHECKSUM,
+    SNAPSHOT_DONE,
+    SNAPSHOT_FAILED,
+};
+
+static const char magic[3] = { 'A', 'C', 'S' };
+
+static const struct {
+    unsigned char offset;
+    unsigned char size;
+} __attribute__((packed)) strings[SNAPSHOT_STRINGS] = {
+    {offsetof(struct data, ssid), sizeof(((struct data *) NULL)->ssid)},
+    {offsetof(struct data, password), sizeof(((struct data *) NULL)->password)},
+    {offsetof(struct data, timezone), sizeof(((struct data *) NULL)->timezone)},
+};
+
+static unsigned int snapshot_crc(unsigned int, const unsigned char *, size_t);
+static const char *snapshot_byte(struct snapshot *, unsigned char);
+static void snapshot_section(struct snapshot *);
+
+size_t snapshot_encode(const struct data *data, unsigned char *buffer)
+{
+    size_t len = 0;
+    memcpy(buffer, magic, sizeof(magic));
+    len += sizeof(magic);
+    buffer[len++] = SNAPSHOT_VERSION;
+    buffer[len++] = data->alarms;
+    for (unsigned char i = 0; i < SNAPSHOT_STRINGS; i++) {
+        const char *value = (const char *)data + strings[i].offset;
+        unsigned char size = strnlen(value, strings[i].size - 1);
+        buffer[len++] = size;
+        memcpy(buffer + len, value, size);
+        len += size;
+    }
+    for (unsigned char i = 0; i < data->alarms; i++) {
+        for (unsigned char j = 0; j < FIELD_ALARM; j++) {
+            buffer[len++] = ((const unsigned char *)&data->alarm[i])[field_alarm[j].offset];
+        }
+    }
+    unsigned int crc = snapshot_crc(0, buffer, len);
+    for (unsigned char i = 0; i < 4; i++) {
+        buffer[len++] = crc >> (i * 8);
+    }
+    return len;
+}
+
+void snapshot_begin(struct snapshot *snapshot)
+{
+    memset(snapshot, 0, sizeof(struct snapshot));
+}
+
+// Decode the next chunk, nothing is kept but the resulting data.
+const char *snapshot_feed(struct snapshot *snapshot, const unsigned char *buffer, size_t size)
+{
+    if (snapshot->state == SNAPSHOT_FAILED) {
+        return "Invalid snapshot.";
+    }
+    for (size_t i = 0; i < size; i++) {
+        const char *err;
+        if ((err = snapshot_byte(snapshot, buffer[i]))) {
+            snapshot->state = SNAPSHOT_FAILED;
+            return err;
+        }
+    }
+    return NULL;
+}
+
+const char *snapshot_end(struct snapshot *snapshot)
+{
+    if (snapshot->state != SNAPSHOT_DONE) {
+        return "Truncated snapshot.";
+    }
+    return NULL;
+}
+
+// Standard reflected crc32, small tables are not worth it for a few hundred bytes.
+static unsigned int snapshot_crc(unsigned int crc, const unsigned char *buffer, size_t size)
+{
+    crc = ~crc;
+    while (size--) {
+        crc ^= *buffer++;
+        for (unsigned char bit = 0; bit < 8; bit++) {
+            crc = crc >> 1 ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+static const char *snapshot_byte(struct snapshot *snapshot, unsigned char byte)
+{
+    if (snapshot->state < SNAPSHOT_CHECKSUM) {
+        snapshot->crc = snapshot_crc(snapshot->crc, &byte, 1);
+    }
+    switch (snapshot->state) {
+    case SNAPSHOT_MAGIC:
+        snapshot->header[snapshot->position++] = byte;
+        if (snapshot->position < SNAPSHOT_HEADER) {
+            return NULL;
+        }
+        if (memcmp(snapshot->header, magic, sizeof(magic))) {
+            return "Not a snapshot.";
+        }
+        if (snapshot->header[3] != SNAPSHOT_VERSION && snapshot->header[3] != 1) {
+            return "Unsupported snapshot version.";
+        }
+        snapshot->fields = snapshot->header[3] == 1 ? FIELD_WEEKLY : FIELD_ALARM;
+        snapshot->count = snapshot->header[4];
+        if (snapshot->count > DATA_ALARMS) {
+            return "Too many alarms on snapshot.";
+        }
+        snapshot->data.alarms = snapshot->count;
+        snapshot->state = SNAPSHOT_LENGTH;
+        snapshot->section = 0;
+        return NULL;
+    case SNAPSHOT_LENGTH:
+        if (byte >= strings[snapshot->section].size) {
+            return "Snapshot string too long.";
+        }
+        snapshot->length = byte;
+        snapshot->position = 0;
+        if (byte) {
+            snapshot->state = SNAPSHOT_STRING;
+        } else {
+            snapshot_section(snapshot);
+        }
+        return NULL;
+    case SNAPSHOT_STRING:
+        // terminated by the zero fill of snapshot_begin
+        ((char *)&snapshot->data + strings[snapshot->section].offset)[snapshot->position++] = byte;
+        if (snapshot->position == snapshot->length) {
+            snapshot_section(snapshot);
+        }
+        return NULL;
+    case SNAPSHOT_ALARM:{
+            const struct field *field = &field_alarm[snapshot->position % snapshot->fields];
+            if (byte > field->max) {
+                return "Snapshot alarm field out of range.";
+            }
+            struct alarm *alarm = &snapshot->data.alarm[snapshot->position / snapshot->fields];
+            ((unsigned char *)alarm)[field->offset] = byte;
+            if (++snapshot->position % snapshot->fields == 0 && !field_valid(alarm)) {
+                return "Snapshot alarm date invalid.";
+            }
+            if (snapshot->position == snapshot->count * snapshot->fields) {
+                snapshot->state = SNAPSHOT_CHECKSUM;
+                snapshot->position = 0;
+            }
+            return NULL;
+        }
+    case SNAPSHOT_CHECKSUM:
+        snapshot->expected |= (unsigned int)byte << (snapshot->position++ * 8);
+        if (snapshot->position < 4) {
+            return NULL;
+        }
+        if (snapshot->expected != snapshot->crc) {
+            return "Snapshot checksum mismatch.";
+        }
+        snapshot->state = SNAPSHOT_DONE;
+        return NULL;
+    default:
+        return "Trailing data after snapshot.";
+    }
+}
+
+// Move to the next string, or to the alarms after the last one.
+static void snapshot_section(struct snapshot *snapshot)
+{
+    snapshot->position = 0;
+    if (++snapshot->section < SNAPSHOT_STRINGS) {
+        snapshot->state = SNAPSHOT_LENGTH;
+    } else if (snapshot->count) {
+        snapshot->state = SNAPSHOT_ALARM;
+    } else {
+        snapshot->state = SNAPSHOT_CHECKSUM;
+    }
+}
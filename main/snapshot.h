@@ -0,0 +1,37 @@
+#ifndef _SNAPSHOT_H
+#define _SNAPSHOT_H
+
+#include <stddef.h>
+
+#include "data.h"
+#include "field.h"
+
+#if DATA_ALARMS > 255
+#error "Snapshots count alarms on a single byte"
+#endif
+
+#define SNAPSHOT_VERSION 2       // 1 has no alarm dates
+#define SNAPSHOT_HEADER 5       // magic, version and alarm count
+#define SNAPSHOT_SIZE (SNAPSHOT_HEADER + 3 + sizeof(((struct data *) NULL)->ssid) \
+    + sizeof(((struct data *) NULL)->password) + sizeof(((struct data *) NULL)->timezone) \
+    + DATA_ALARMS * FIELD_ALARM + 4)
+
+struct snapshot {
+    struct data data;           // decoded so far
+    unsigned int crc;
+    unsigned int expected;
+    unsigned char state;
+    unsigned char section;      // string being decoded
+    unsigned char length;       // of the string being decoded
+    unsigned char count;        // alarms on the snapshot
+    unsigned char fields;       // per alarm on the snapshot version
+    unsigned short position;    // inside the current state
+    unsigned char header[SNAPSHOT_HEADER];
+} __attribute__((packed));
+
+size_t snapshot_encode(const struct data *, unsigned char *);
+void snapshot_begin(struct snapshot *);
+const char *snapshot_feed(struct snapshot *, const unsigned char *, size_t);
+const char *snapshot_end(struct snapshot *);
+
+#endif
@@ -0,0 +1,130 @@
+#include <stdbool.h>
+
+#include "sound.h"
+#include "synth.h"
+#include "power.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "driver/i2s_std.h"
+#include "esp_task.h"
+
+#define SOUND_FRAMES 240        // 15 ms per DMA buffer
+#define SOUND_BUFFERS 4
+
+static i2s_chan_handle_t channel = NULL;
+static QueueHandle_t queue = NULL;
+static TaskHandle_t task = NULL;
+static struct synth synth;
+static volatile bool playing = false;
+
+struct sound_buffer {
+    short *data;
+    size_t size;
+} __attribute__((packed));
+
+static bool sound_sent(i2s_chan_handle_t, i2s_event_data_t *, void *);
+static void sound_task(void *);
+
+const char *sound_init()
+{
+    if (channel) {
+        return NULL;
+    }
+    synth_init();
+    i2s_chan_config_t chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM_AUTO, I2S_ROLE_MASTER);
+    chan_cfg.dma_desc_num = SOUND_BUFFERS;
+    chan_cfg.dma_frame_num = SOUND_FRAMES;
+    if (i2s_new_channel(&chan_cfg, &channel, NULL) != ESP_OK) {
+        return "Unable to create sound channel.";
+    }
+    i2s_std_config_t std_cfg = {
+        .clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(SYNTH_RATE),
+        .slot_cfg = I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_16BIT, I2S_SLOT_MODE_MONO),
+        .gpio_cfg = {
+                     .mclk = I2S_GPIO_UNUSED,
+                     .bclk = 4,
+                     .ws = 5,
+                     .dout = 6,
+                     .din = I2S_GPIO_UNUSED,
+                     },
+    };
+    if (i2s_channel_init_std_mode(channel, &std_cfg) != ESP_OK) {
+        return "Unable to setup sound channel.";
+    }
+    queue = xQueueCreate(SOUND_BUFFERS, sizeof(struct sound_buffer));
+    if (!queue) {
+        return "Unable to create sound queue.";
+    }
+    const i2s_event_callbacks_t callbacks = {
+        .on_sent = sound_sent,
+    };
+    if (i2s_channel_register_event_callback(channel, &callbacks, NULL) != ESP_OK) {
+        return "Unable to register sound callback.";
+    }
+    // below the alarm loop in the main task, so rendering never delays the LED output
+    if (xTaskCreate(sound_task, "sound", 2048, NULL, ESP_TASK_MAIN_PRIO > tskIDLE_PRIORITY ? ESP_TASK_MAIN_PRIO - 1 :
+                    tskIDLE_PRIORITY, &task) != pdPASS) {
+        return "Unable to create sound task.";
+    }
+    return NULL;
+}
+
+// Play melody at volume, fading in over fade seconds of which elapsed have already passed.
+const char *sound_start(unsigned char melody, unsigned char volume, unsigned int fade, unsigned int elapsed)
+{
+    if (playing) {
+        return NULL;
+    }
+    synth_start(&synth, melody, volume, fade * SYNTH_RATE, elapsed * SYNTH_RATE);
+    // the DMA buffers still hold the end of the last ring, play silence until the task refills them
+    static const short silence[SOUND_FRAMES] = { 0 };
+    size_t loaded = sizeof(silence);
+    for (int i = 0; i < SOUND_BUFFERS && loaded == sizeof(silence); i++) {
+        loaded = 0;
+        i2s_channel_preload_data(channel, silence, sizeof(silence), &loaded);
+    }
+    playing = true;
+    if (i2s_channel_enable(channel) != ESP_OK) {
+        playing = false;
+        return "Unable to start sound channel.";
+    }
+    power_hold(POWER_RING, true);
+    return NULL;
+}
+
+void sound_stop()
+{
+    if (!playing) {
+        return;
+    }
+    i2s_channel_disable(channel);
+    playing = false;
+    xQueueReset(queue);
+    power_hold(POWER_RING, false);
+}
+
+// A DMA buffer was sent and is free until the other ones are played, hand it to the task.
+static bool IRAM_ATTR sound_sent(i2s_chan_handle_t handle, i2s_event_data_t *event, void *ctx)
+{
+    BaseType_t woken = pdFALSE;
+    struct sound_buffer buffer = {
+        .data = event->dma_buf,
+        .size = event->size
+    };
+    xQueueSendFromISR(queue, &buffer, &woken);
+    return woken == pdTRUE;
+}
+
+// Render straight into the DMA buffer, samples are written once and never copied.
+static void sound_task(void *arg)
+{
+    struct sound_buffer buffer;
+    for (;;) {
+        if (xQueueReceive(queue, &buffer, portMAX_DELAY) != pdTRUE || !playing) {
+            continue;
+        }
+        synth_render(&synth, buffer.data, buffer.size / sizeof(short));
+    }
+}
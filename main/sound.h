@@ -0,0 +1,8 @@
+#ifndef _SOUND_H
+#define _SOUND_H
+
+const char *sound_init();
+const char *sound_start(unsigned char, unsigned char, unsigned int, unsigned int);
+void sound_stop();
+
+#endif
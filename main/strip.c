@@ -0,0 +1,77 @@
+#include <string.h>
+
+#include "strip.h"
+
+#define STRIP_SCALE(value, level) ((((value) * (level) + 128) * 257) >> 16)     // value * level / 255
+
+static unsigned int patterns[256];      // 24 spi bits of a byte, 100 for 0 and 110 for 1, msb first
+
+void strip_init()
+{
+    for (int value = 0; value < 256; value++) {
+        unsigned int pattern = 0x924924;
+        for (int bit = 0; bit < 8; bit++) {
+            pattern |= ((value >> bit) & 1) << (bit * 3 + 1);
+        }
+        patterns[value] = pattern;
+    }
+}
+
+// Red, green, blue of an index on the 6 level rgb cube, channel 0 on the lowest digit is blue.
+void strip_colour(unsigned char colour, unsigned char *rgb)
+{
+    rgb[0] = ((colour / (6 * 6)) % 6) * (255 / 5);
+    rgb[1] = ((colour / 6) % 6) * (255 / 5);
+    rgb[2] = (colour % 6) * (255 / 5);
+}
+
+// Whole strip in one rgb colour at level.
+void strip_fill(unsigned char *frame, unsigned short count, const unsigned char *rgb, unsigned char level)
+{
+    unsigned char pixel[3];
+    for (int channel = 0; channel < 3; channel++) {
+        pixel[channel] = STRIP_SCALE(rgb[channel], level);
+    }
+    for (unsigned short led = 0; led < count; led++, frame += 3) {
+        memcpy(frame, pixel, 3);
+    }
+}
+
+// Gradient from bottom on led 0 to top on the last led, lit from the bottom up: the front climbs the strip over the
+// first half of level and everything reaches full brightness with it.
+void strip_rise(unsigned char *frame, unsigned short count, const unsigned char *bottom, const unsigned char *top,
+                unsigned char level)
+{
+    // Q16 height on the strip, rounded up so the last led lands on the top colour
+    unsigned int step = count > 1 ? (0xFFFF + count - 2) / (count - 1) : 0;
+    int delta[3];
+    for (int channel = 0; channel < 3; channel++) {
+        delta[channel] = top[channel] - bottom[channel];
+    }
+    for (unsigned short led = 0; led < count; led++, frame += 3) {
+        unsigned int position = led * step > 0xFFFF ? 0xFFFF : led * step;
+        int lit = 2 * level - (position >> 8);
+        lit = lit < 0 ? 0 : lit > 255 ? 255 : lit;
+        for (int channel = 0; channel < 3; channel++) {
+            unsigned int value = bottom[channel] + ((delta[channel] * (int)position + 0x8000) >> 16);
+            frame[channel] = STRIP_SCALE(value, lit);
+        }
+    }
+}
+
+// Spi stream of an rgb frame in WS2812 order, followed by the reset, returns the byte count.
+size_t strip_encode(const unsigned char *frame, unsigned short count, unsigned char *out)
+{
+    static const unsigned char order[3] = { 1, 0, 2 };  // green, red, blue
+    unsigned char *start = out;
+    for (unsigned short led = 0; led < count; led++, frame += 3) {
+        for (int channel = 0; channel < 3; channel++) {
+            unsigned int pattern = patterns[frame[order[channel]]];
+            *out++ = pattern >> 16;
+            *out++ = pattern >> 8;
+            *out++ = pattern;
+        }
+    }
+    memset(out, 0, STRIP_RESET);
+    return out + STRIP_RESET - start;
+}
@@ -0,0 +1,19 @@
+#ifndef _STRIP_H
+#define _STRIP_H
+
+#include <stddef.h>
+
+#define STRIP_RATE 2400000      // spi bits per second, 3 per WS2812 bit
+#define STRIP_BYTES 9           // spi bytes per led, 24 bits green red blue
+#define STRIP_RESET 90          // low spi bytes latching the frame, 300 us
+#define STRIP_SIZE(count) ((count) * STRIP_BYTES + STRIP_RESET)
+#define STRIP_SUNRISE_BOTTOM { 160, 16, 0 }     // deep red
+#define STRIP_SUNRISE_TOP { 255, 190, 120 }     // warm white
+
+void strip_init();
+void strip_colour(unsigned char, unsigned char *);
+void strip_fill(unsigned char *, unsigned short, const unsigned char *, unsigned char);
+void strip_rise(unsigned char *, unsigned short, const unsigned char *, const unsigned char *, unsigned char);
+size_t strip_encode(const unsigned char *, unsigned short, unsigned char *);
+
+#endif
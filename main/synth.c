@@ -0,0 +1,144 @@
+#include <string.h>
+
+#include "synth.h"
+
+#define SYNTH_TICK (SYNTH_RATE / 16)    // melody lengths in 1/16 seconds
+
+enum synth_wave {
+    SYNTH_SINE = 0,
+    SYNTH_ORGAN,
+    SYNTH_TRIANGLE,
+    SYNTH_WAVES,
+};
+
+struct synth_note {
+    unsigned char key;          // midi note number, 0 is a rest
+    unsigned char length;       // 1/16 seconds
+} __attribute__((packed));
+
+struct synth_melody {
+    unsigned char wave;
+    unsigned char count;
+    const struct synth_note *notes;
+} __attribute__((packed));
+
+static const short sine[256] = {
+    0, 804, 1608, 2410, 3212, 4011, 4808, 5602, 6393, 7179, 7962, 8739, 9512, 10278, 11039, 11793,
+    12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530, 18204, 18868, 19519, 20159, 20787, 21403, 22005, 22594,
+    23170, 23731, 24279, 24811, 25329, 25832, 26319, 26790, 27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956,
+    30273, 30571, 30852, 31113, 31356, 31580, 31785, 31971, 32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757,
+    32767, 32757, 32728, 32678, 32609, 32521, 32412, 32285, 32137, 31971, 31785, 31580, 31356, 31113, 30852, 30571,
+    30273, 29956, 29621, 29268, 28898, 28510, 28105, 27683, 27245, 26790, 26319, 25832, 25329, 24811, 24279, 23731,
+    23170, 22594, 22005, 21403, 20787, 20159, 19519, 18868, 18204, 17530, 16846, 16151, 15446, 14732, 14010, 13279,
+    12539, 11793, 11039, 10278, 9512, 8739, 7962, 7179, 6393, 5602, 4808, 4011, 3212, 2410, 1608, 804,
+    0, -804, -1608, -2410, -3212, -4011, -4808, -5602, -6393, -7179, -7962, -8739, -9512, -10278, -11039, -11793,
+    -12539, -13279, -14010, -14732, -15446, -16151, -16846, -17530, -18204, -18868, -19519, -20159, -20787, -21403, -22005, -22594,
+    -23170, -23731, -24279, -24811, -25329, -25832, -26319, -26790, -27245, -27683, -28105, -28510, -28898, -29268, -29621, -29956,
+    -30273, -30571, -30852, -31113, -31356, -31580, -31785, -31971, -32137, -32285, -32412, -32521, -32609, -32678, -32728, -32757,
+    -32767, -32757, -32728, -32678, -32609, -32521, -32412, -32285, -32137, -31971, -31785, -31580, -31356, -31113, -30852, -30571,
+    -30273, -29956, -29621, -29268, -28898, -28510, -28105, -27683, -27245, -26790, -26319, -25832, -25329, -24811, -24279, -23731,
+    -23170, -22594, -22005, -21403, -20787, -20159, -19519, -18868, -18204, -17530, -16846, -16151, -15446, -14732, -14010, -13279,
+    -12539, -11793, -11039, -10278, -9512, -8739, -7962, -7179, -6393, -5602, -4808, -4011, -3212, -2410, -1608, -804,
+};
+
+// note frequencies of the fourth octave in 1/16 Hz
+static const unsigned short octave[12] = {
+    4186, 4435, 4699, 4978, 5274, 5588, 5920, 6272, 6645, 7040, 7459, 7902
+};
+
+static const struct synth_note beep[] = {
+    {81, 2}, {0, 2}, {81, 2}, {0, 10}
+};
+
+static const struct synth_note chime[] = {
+    {64, 8}, {68, 8}, {66, 8}, {59, 16}, {0, 8},
+    {64, 8}, {66, 8}, {68, 8}, {64, 16}, {0, 24}
+};
+
+static const struct synth_note rise[] = {
+    {72, 4}, {76, 4}, {79, 4}, {84, 8}, {0, 12}
+};
+
+static const struct synth_melody melodies[SYNTH_MELODIES] = {
+    {SYNTH_SINE, sizeof(beep) / sizeof(*beep), beep},
+    {SYNTH_ORGAN, sizeof(chime) / sizeof(*chime), chime},
+    {SYNTH_TRIANGLE, sizeof(rise) / sizeof(*rise), rise},
+};
+
+static short tables[SYNTH_WAVES][256];
+
+static void synth_next(struct synth *);
+
+// Build the derived wavetables once, before any render.
+void synth_init()
+{
+    memcpy(tables[SYNTH_SINE], sine, sizeof(sine));
+    for (int i = 0; i < 256; i++) {
+        // fundamental with half second and quarter third harmonic, scaled back by 4/7
+        int organ = sine[i] + sine[(i * 2) & 0xFF] / 2 + sine[(i * 3) & 0xFF] / 4;
+        tables[SYNTH_ORGAN][i] = organ * 4 / 7;
+        int triangle = i < 64 ? i : i < 192 ? 128 - i : i - 256;
+        tables[SYNTH_TRIANGLE][i] = triangle * 32767 / 64;
+    }
+}
+
+// Start a melody fading in to volume over fade samples, skipping elapsed samples of the fade.
+void synth_start(struct synth *synth, unsigned char melody, unsigned char volume, unsigned int fade,
+                 unsigned int elapsed)
+{
+    memset(synth, 0, sizeof(struct synth));
+    synth->melody = &melodies[melody % SYNTH_MELODIES];
+    synth->note = synth->melody->count - 1;
+    synth->target = 0xFFFFFFFFU / 255 * volume;
+    if (!fade || elapsed >= fade) {
+        synth->gain = synth->target;
+    } else {
+        synth->step = synth->target / fade;
+        synth->gain = synth->step * elapsed;
+    }
+    synth_next(synth);
+}
+
+void synth_render(struct synth *synth, short *out, size_t count)
+{
+    const short *table = tables[synth->melody->wave];
+    while (count) {
+        size_t run = count < synth->left ? count : synth->left;
+        for (size_t i = 0; i < run; i++) {
+            int sample = table[synth->phase >> 24] * (int)(synth->envelope >> 1) >> 15;
+            out[i] = (long long)sample * (synth->gain >> 16) >> 16;
+            synth->phase += synth->increment;
+            synth->envelope -= synth->decay;
+            if (synth->gain < synth->target) {
+                synth->gain = synth->target - synth->gain > synth->step ? synth->gain + synth->step : synth->target;
+            }
+        }
+        out += run;
+        count -= run;
+        synth->left -= run;
+        if (!synth->left) {
+            synth_next(synth);
+        }
+    }
+}
+
+static void synth_next(struct synth *synth)
+{
+    synth->note = (synth->note + 1) % synth->melody->count;
+    const struct synth_note *note = &synth->melody->notes[synth->note];
+    synth->left = note->length * SYNTH_TICK;
+    synth->phase = 0;
+    if (!note->key) {
+        synth->increment = 0;
+        synth->envelope = 0;
+        synth->decay = 0;
+        return;
+    }
+    // octave index 5 holds the table above, midi 60 is C4
+    int shift = note->key / 12 - 5;
+    unsigned long long frequency = octave[note->key % 12];
+    frequency = shift < 0 ? frequency >> -shift : frequency << shift;
+    synth->increment = (frequency << 28) / SYNTH_RATE;
+    synth->envelope = 0xFFFF;
+    synth->decay = 0xFFFF / synth->left;
+}
@@ -0,0 +1,28 @@
+#ifndef _SYNTH_H
+#define _SYNTH_H
+
+#include <stddef.h>
+
+#define SYNTH_RATE 16000        // samples per second, mono
+#define SYNTH_MELODIES 3
+
+struct synth_melody;
+
+struct synth {
+    const struct synth_melody *melody;
+    unsigned char note;         // position on the melody
+    unsigned int left;          // samples left on the current note
+    unsigned int phase;         // wavetable position, top 8 bits index
+    unsigned int increment;
+    unsigned int envelope;      // Q16 note amplitude
+    unsigned int decay;
+    unsigned int gain;          // Q32 fraction of full scale
+    unsigned int target;
+    unsigned int step;
+};
+
+void synth_init();
+void synth_start(struct synth *, unsigned char, unsigned char, unsigned int, unsigned int);
+void synth_render(struct synth *, short *, size_t);
+
+#endif
@@ -0,0 +1,44 @@
+#include <string.h>
+
+#include "update.h"
+
+const char *update_begin(struct update *update, const struct update_writer *writer, void *context, size_t size)
+{
+    update->writer = writer;
+    update->context = context;
+    update->size = size;
+    update->written = 0;
+    sha256_init(&update->sha256);
+    return writer->begin(context, size);
+}
+
+// Hash and pass on a chunk as it arrives, nothing is buffered here.
+const char *update_write(struct update *update, const void *data, size_t size)
+{
+    if (update->written + size > update->size) {
+        return "Firmware image longer than announced.";
+    }
+    sha256_update(&update->sha256, data, size);
+    update->written += size;
+    return update->writer->write(update->context, data, size);
+}
+
+// Check the digest when expected is given, the computed one is stored on digest either way.
+const char *update_end(struct update *update, const unsigned char *expected, unsigned char *digest)
+{
+    if (update->written != update->size) {
+        update_abort(update);
+        return "Firmware image truncated.";
+    }
+    sha256_final(&update->sha256, digest);
+    if (expected && memcmp(expected, digest, 32)) {
+        update_abort(update);
+        return "Firmware image digest mismatch.";
+    }
+    return update->writer->end(update->context);
+}
+
+void update_abort(struct update *update)
+{
+    update->writer->abort(update->context);
+}
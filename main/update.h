@@ -0,0 +1,29 @@
+#ifndef _UPDATE_H
+#define _UPDATE_H
+
+#include <stddef.h>
+
+#include "sha256.h"
+
+// Destination of a firmware image, written in arrival order.
+struct update_writer {
+    const char *(*begin)(void *, size_t);
+    const char *(*write)(void *, const void *, size_t);
+    const char *(*end)(void *);
+    void (*abort)(void *);
+};
+
+struct update {
+    const struct update_writer *writer;
+    void *context;
+    struct sha256 sha256;
+    size_t size;
+    size_t written;
+};
+
+const char *update_begin(struct update *, const struct update_writer *, void *, size_t);
+const char *update_write(struct update *, const void *, size_t);
+const char *update_end(struct update *, const unsigned char *, unsigned char *);
+void update_abort(struct update *);
+
+#endif
@@ -2,6 +2,10 @@
 #include "data.h"
 #include "dns.h"
 #include "setup.h"
+#include "latency.h"
+#include "zone.h"
+
+#include "sdkconfig.h"
 
 #include "esp_event.h"
 #include "esp_wifi.h"
@@ -105,8 +109,7 @@ const char *wifi_ap_init(struct data *data)
     if ((err = data_write(data))) {
         return err;
     }
-    setenv("TZ", data->timezone, 1);
-    tzset();
+    zone_set(data->timezone);
     return wifi_deinit();
 }
 
@@ -151,6 +154,9 @@ const char *wifi_sta_init(struct data *data)
         .sta = {
                 .ssid = {0},
                 .password = {0},
+#ifdef CONFIG_ALARM_POWER_SAVE
+                .listen_interval = CONFIG_ALARM_POWER_LISTEN_INTERVAL,
+#endif
                 .pmf_cfg = {
                             .capable = true,
                             .required = false,
@@ -167,6 +173,16 @@ const char *wifi_sta_init(struct data *data)
         wifi_deinit();
         return "Unable to setup wifi station config.";
     }
+#ifdef CONFIG_ALARM_POWER_SAVE
+    // radio off between the beacons of the listen interval
+    if (esp_wifi_set_ps(WIFI_PS_MAX_MODEM) != ESP_OK) {
+        esp_event_handler_instance_unregister(WIFI_EVENT, ESP_EVENT_ANY_ID, reconnect_handler);
+        esp_event_handler_instance_unregister(IP_EVENT, IP_EVENT_STA_GOT_IP, ip_handler);
+        vSemaphoreDelete(signal);
+        wifi_deinit();
+        return "Unable to set wifi power save.";
+    }
+#endif
     if (esp_wifi_start() != ESP_OK) {
         esp_event_handler_instance_unregister(WIFI_EVENT, ESP_EVENT_ANY_ID, reconnect_handler);
         esp_event_handler_instance_unregister(IP_EVENT, IP_EVENT_STA_GOT_IP, ip_handler);
@@ -242,7 +258,10 @@ static void wifi_connect(void *arg, esp_event_base_t base, int32_t id, void *dat
     } else if (base == WIFI_EVENT) {
         if (id == WIFI_EVENT_STA_START) {
             esp_wifi_connect();
+        } else if (id == WIFI_EVENT_STA_CONNECTED) {
+            latency_cause(LATENCY_WIFI, false);
         } else if (id == WIFI_EVENT_STA_DISCONNECTED) {
+            latency_cause(LATENCY_WIFI, true);
             vTaskDelay(pdMS_TO_TICKS(5000));
             esp_wifi_connect();
         }
@@ -0,0 +1,285 @@
+#include <stdbool.h>
+#include <string.h>
+
+#include "zone.h"
+
+struct zone_rule {
+    char kind;                  // 'M' month week weekday, 'J' day without leap day, 0 zero based day
+    unsigned char month;
+    unsigned char week;         // 5 is the last one of the month
+    unsigned char weekday;
+    unsigned short day;
+    int time;                   // seconds after local midnight, may leave the day
+};
+
+static struct {
+    int std;                    // seconds east of UTC
+    int dst;
+    bool daylight;
+    struct zone_rule rule[2];   // start and end of daylight time
+    time_t from;                // span of the table, empty until the first conversion
+    time_t until;
+    unsigned char count;
+    time_t at[ZONE_TRANSITIONS];        // ascending instants of offset changes
+    int offset[ZONE_TRANSITIONS + 1];   // in effect before each change and after the last
+} zone;
+
+static bool zone_parse(const char *);
+static const char *zone_name(const char *);
+static const char *zone_seconds(const char *, int, int *);
+static const char *zone_rule(const char *, struct zone_rule *);
+static int zone_find(time_t);
+static void zone_build(time_t);
+static int zone_rule_day(const struct zone_rule *, int);
+static void zone_civil(time_t, struct tm *);
+
+// Rules it cannot parse leave UTC, like libc.
+void zone_set(const char *tz)
+{
+    memset(&zone, 0, sizeof(zone));
+    if (!zone_parse(tz)) {
+        memset(&zone, 0, sizeof(zone));
+    }
+    zone.offset[0] = zone.std;
+}
+
+void zone_local(time_t t, struct tm *tm)
+{
+    int offset = zone.offset[zone_find(t)];
+    zone_civil(t + offset, tm);
+    tm->tm_isdst = zone.daylight && offset == zone.dst;
+}
+
+// Normalizes tm like mktime. Without a tm_isdst hint repeated local times resolve to the first one and skipped ones
+// count as standard time.
+time_t zone_epoch(struct tm *tm)
+{
+    int year = tm->tm_year + 1900 + tm->tm_mon / 12;
+    int month = tm->tm_mon % 12;
+    if (month < 0) {
+        month += 12;
+        year--;
+    }
+    time_t local = ((time_t)zone_day(year, month + 1, 1) + tm->tm_mday - 1) * 86400 + (time_t)tm->tm_hour * 3600 +
+        (time_t)tm->tm_min * 60 + tm->tm_sec;
+    time_t t = local - zone.std;
+    if (zone.daylight && tm->tm_isdst >= 0) {
+        t = local - (tm->tm_isdst ? zone.dst : zone.std);
+    } else if (zone.daylight) {
+        time_t summer = local - zone.dst;
+        bool standard = zone.offset[zone_find(t)] == zone.std;
+        bool daylight = zone.offset[zone_find(summer)] == zone.dst;
+        if (daylight && (!standard || summer < t)) {
+            t = summer;
+        }
+    }
+    zone_local(t, tm);
+    return t;
+}
+
+// Days since 1970-01-01 of a proleptic gregorian date, month 13 is january of the next year.
+int zone_day(int year, int month, int day)
+{
+    year -= month <= 2;
+    int era = year / 400;
+    int yoe = year - era * 400;
+    int doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    return era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy - 719468;
+}
+
+// std offset [dst [offset] [,start[/time],end[/time]]], offsets west of UTC.
+static bool zone_parse(const char *s)
+{
+    int seconds;
+    if (!(s = zone_name(s)) || !(s = zone_seconds(s, 24, &seconds))) {
+        return false;
+    }
+    zone.std = zone.dst = -seconds;
+    if (!*s) {
+        return true;
+    }
+    if (!(s = zone_name(s))) {
+        return false;
+    }
+    zone.daylight = true;
+    zone.dst = zone.std + 3600;
+    if (*s && *s != ',') {
+        if (!(s = zone_seconds(s, 24, &seconds))) {
+            return false;
+        }
+        zone.dst = -seconds;
+    }
+    if (!*s) {
+        s = ZONE_RULES;
+    }
+    for (int i = 0; i < 2; i++) {
+        if (*s++ != ',' || !(s = zone_rule(s, &zone.rule[i]))) {
+            return false;
+        }
+    }
+    return !*s;
+}
+
+// Three letters at least, or anything but '>' quoted in angle brackets.
+static const char *zone_name(const char *s)
+{
+    const char *start = s;
+    if (*s == '<') {
+        while (*++s && *s != '>');
+        return *s && s - start > 3 ? s + 1 : NULL;
+    }
+    while ((*s >= 'A' && *s <= 'Z') || (*s >= 'a' && *s <= 'z')) {
+        s++;
+    }
+    return s - start >= 3 ? s : NULL;
+}
+
+// [+-]hh[:mm[:ss]] with hours up to limit.
+static const char *zone_seconds(const char *s, int limit, int *seconds)
+{
+    int sign = *s == '-' ? -1 : 1;
+    if (*s == '-' || *s == '+') {
+        s++;
+    }
+    int value = 0;
+    for (int i = 0; i < 3; i++) {
+        int part = 0;
+        const char *start = s;
+        while (*s >= '0' && *s <= '9' && s - start < 3) {
+            part = part * 10 + *s++ - '0';
+        }
+        if (s == start || part > (i ? 59 : limit)) {
+            return NULL;
+        }
+        value = value * 60 + part;
+        if (*s != ':' || i == 2) {
+            for (; i < 2; i++) {
+                value *= 60;
+            }
+            break;
+        }
+        s++;
+    }
+    *seconds = sign * value;
+    return s;
+}
+
+static const char *zone_rule(const char *s, struct zone_rule *rule)
+{
+    memset(rule, 0, sizeof(struct zone_rule));
+    int values[3] = { 0 }, limits[3][2] = { { 0, 365 } };
+    int count = 1;
+    if (*s == 'M') {
+        rule->kind = *s++;
+        count = 3;
+        memcpy(limits, (int[3][2]) { { 1, 12 }, { 1, 5 }, { 0, 6 } }, sizeof(limits));
+    } else if (*s == 'J') {
+        rule->kind = *s++;
+        limits[0][0] = 1;
+    }
+    for (int i = 0; i < count; i++) {
+        if (i && *s++ != '.') {
+            return NULL;
+        }
+        const char *start = s;
+        while (*s >= '0' && *s <= '9' && s - start < 3) {
+            values[i] = values[i] * 10 + *s++ - '0';
+        }
+        if (s == start || values[i] < limits[i][0] || values[i] > limits[i][1]) {
+            return NULL;
+        }
+    }
+    rule->day = values[0];
+    rule->month = values[0];
+    rule->week = values[1];
+    rule->weekday = values[2];
+    rule->time = 7200;
+    if (*s == '/') {
+        return zone_seconds(s + 1, 167, &rule->time);
+    }
+    return s;
+}
+
+static int zone_find(time_t t)
+{
+    if (zone.daylight && (t < zone.from || t >= zone.until)) {
+        zone_build(t);
+    }
+    int low = 0, high = zone.count;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (zone.at[middle] <= t) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+// Changes of the years around the one of t, the table holds for the middle three.
+static void zone_build(time_t t)
+{
+    zone.count = 0;
+    struct tm tm;
+    zone_civil(t, &tm);
+    int year = tm.tm_year + 1900 - ZONE_YEARS / 2;
+    zone.from = (time_t)zone_day(year + 1, 1, 1) * 86400;
+    zone.until = (time_t)zone_day(year + ZONE_YEARS - 1, 1, 1) * 86400;
+    for (int i = 0; i < ZONE_TRANSITIONS; i++) {
+        // daylight time starts in standard time and ends in daylight time
+        const struct zone_rule *rule = &zone.rule[i % 2];
+        int before = i % 2 ? zone.dst : zone.std;
+        time_t at = (time_t)zone_rule_day(rule, year + i / 2) * 86400 + rule->time - before;
+        unsigned char j = zone.count++;
+        for (; j && zone.at[j - 1] > at; j--) {
+            zone.at[j] = zone.at[j - 1];
+            zone.offset[j + 1] = zone.offset[j];
+        }
+        zone.at[j] = at;
+        zone.offset[j + 1] = i % 2 ? zone.std : zone.dst;
+    }
+    zone.offset[0] = zone.offset[1] == zone.dst ? zone.std : zone.dst;
+}
+
+// Local midnight of the rule date in days since 1970-01-01.
+static int zone_rule_day(const struct zone_rule *rule, int year)
+{
+    int first = zone_day(year, 1, 1);
+    if (rule->kind == 'J') {
+        bool leap = zone_day(year, 3, 1) - zone_day(year, 2, 28) == 2;
+        return first + rule->day - 1 + (leap && rule->day >= 60);
+    }
+    if (rule->kind != 'M') {
+        return first + rule->day;
+    }
+    int day = zone_day(year, rule->month, 1);
+    day += (rule->weekday - (day % 7 + 11) % 7 + 7) % 7 + (rule->week - 1) * 7;
+    int next = zone_day(year, rule->month + 1, 1);
+    while (day >= next) {
+        day -= 7;
+    }
+    return day;
+}
+
+static void zone_civil(time_t local, struct tm *tm)
+{
+    time_t days = local / 86400 - (local % 86400 < 0);
+    int seconds = local - days * 86400;
+    tm->tm_hour = seconds / 3600;
+    tm->tm_min = seconds / 60 % 60;
+    tm->tm_sec = seconds % 60;
+    tm->tm_wday = (days % 7 + 11) % 7;
+    time_t z = days + 719468;
+    time_t era = (z >= 0 ? z : z - 146096) / 146097;
+    int doe = z - era * 146097;
+    int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int mp = (5 * doy + 2) / 153;
+    int month = mp < 10 ? mp + 3 : mp - 9;
+    int year = yoe + era * 400 + (month <= 2);
+    tm->tm_year = year - 1900;
+    tm->tm_mon = month - 1;
+    tm->tm_mday = doy - (153 * mp + 2) / 5 + 1;
+    tm->tm_yday = days - zone_day(year, 1, 1);
+}
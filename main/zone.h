@@ -0,0 +1,17 @@
+#ifndef _ZONE_H
+#define _ZONE_H
+
+#include <time.h>
+
+#define ZONE_YEARS 5            // years of transitions computed around the converted instant
+#define ZONE_TRANSITIONS (2 * ZONE_YEARS)
+#define ZONE_RULES ",M3.2.0,M11.1.0"   // daylight rules of zones naming none, as libc does
+
+// POSIX TZ rules parsed once into a table of offset changes, conversions without libc and its environment lookups.
+// Callers serialize through the engine lock, the table refreshes on the first conversion out of its span.
+void zone_set(const char *);
+void zone_local(time_t, struct tm *);
+time_t zone_epoch(struct tm *);
+int zone_day(int, int, int);
+
+#endif
@@ -0,0 +1,76 @@
+// Replay a recorded light sensor trace through the ambient filter chain, on the host:
+// cc -O2 -I../main -o ambient ambient.c ../main/filter.c && ./ambient trace.txt > scale.csv
+// The trace holds one 12 bit ADC sample per line at the firmware sample rate, lines starting with # are skipped. Every
+// filter update goes to stdout as csv with the scale the firmware would apply at that point, the cost to stderr.
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "filter.h"
+
+#define AMBIENT_FRAME 256       // samples per DMA frame on the firmware
+
+int main(int argc, char **argv)
+{
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <trace.txt>\n", argv[0]);
+        return 1;
+    }
+    FILE *file = fopen(argv[1], "r");
+    if (!file) {
+        perror(argv[1]);
+        return 1;
+    }
+    size_t count = 0, size = 0;
+    unsigned short *samples = NULL;
+    char line[64];
+    while (fgets(line, sizeof(line), file)) {
+        if (*line == '#' || *line == '\n') {
+            continue;
+        }
+        if (count == size) {
+            size = size ? size * 2 : 65536;
+            if (!(samples = realloc(samples, size * sizeof(unsigned short)))) {
+                fprintf(stderr, "No memory.\n");
+                return 1;
+            }
+        }
+        int value = atoi(line);
+        samples[count++] = value < 0 ? 0 : value > 4095 ? 4095 : value;
+    }
+    fclose(file);
+    struct filter filter;
+    filter_start(&filter);
+    unsigned short applied = FILTER_UNIT;
+    long long updated = -FILTER_PERIOD;
+    unsigned int updates = 0, changes = 0;
+    printf("time,level,scale,applied\n");
+    for (size_t i = 0; i < count; i++) {
+        if (!filter_feed(&filter, &samples[i], 1)) {
+            continue;
+        }
+        updates++;
+        long long now = (long long)(i + 1) * 1000 / FILTER_RATE;
+        unsigned short level = filter_level(&filter);
+        unsigned short scale = filter_scale(level);
+        if (abs(scale - applied) >= FILTER_STEP && now - updated >= FILTER_PERIOD) {
+            applied = scale;
+            updated = now;
+            changes++;
+        }
+        printf("%.3f,%u,%u,%u\n", now / 1000.0, level, scale, applied);
+    }
+    // again in whole DMA frames for the cost, as the firmware feeds it
+    struct timespec start, end;
+    filter_start(&filter);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < count; i += AMBIENT_FRAME) {
+        filter_feed(&filter, &samples[i], count - i < AMBIENT_FRAME ? count - i : AMBIENT_FRAME);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    fprintf(stderr, "%zu samples (%.1f s), %u filter updates, %u scale changes, %.2f ns per sample (%u)\n", count,
+            (double)count / FILTER_RATE, updates, changes, count ? elapsed / count : 0, filter_level(&filter));
+    free(samples);
+    return 0;
+}
@@ -0,0 +1,9 @@
+// Stand-in for the load harness, see httpd.c.
+#ifndef _LOAD_ESP_EVENT_H
+#define _LOAD_ESP_EVENT_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#endif
@@ -0,0 +1,95 @@
+// Stand-in for the load harness, see httpd.c.
+#ifndef _LOAD_ESP_HTTP_SERVER_H
+#define _LOAD_ESP_HTTP_SERVER_H
+
+#include <sys/types.h>
+
+#include "esp_err.h"
+
+#define HTTPD_RESP_USE_STRLEN -1
+#define HTTPD_SOCK_ERR_FAIL -1
+#define HTTPD_SOCK_ERR_INVALID -2
+#define HTTPD_SOCK_ERR_TIMEOUT -3
+#define HTTPD_MAX_URI_LEN 512
+
+typedef void *httpd_handle_t;
+
+typedef enum {
+    HTTP_GET = 1,
+    HTTP_POST,
+    HTTP_PUT,
+} httpd_method_t;
+
+typedef enum {
+    HTTPD_500_INTERNAL_SERVER_ERROR = 0,
+    HTTPD_400_BAD_REQUEST,
+    HTTPD_404_NOT_FOUND,
+    HTTPD_405_METHOD_NOT_ALLOWED,
+    HTTPD_408_REQ_TIMEOUT,
+    HTTPD_413_CONTENT_TOO_LARGE,
+    HTTPD_431_REQ_HDR_FIELDS_TOO_LARGE,
+    HTTPD_ERR_CODE_MAX,
+} httpd_err_code_t;
+
+typedef struct httpd_req {
+    httpd_handle_t handle;
+    httpd_method_t method;
+    const char uri[HTTPD_MAX_URI_LEN + 1];
+    size_t content_len;
+    void *aux;
+    void *user_ctx;
+} httpd_req_t;
+
+typedef struct httpd_uri {
+    const char *uri;
+    httpd_method_t method;
+    esp_err_t (*handler)(httpd_req_t *);
+    void *user_ctx;
+} httpd_uri_t;
+
+typedef bool (*httpd_uri_match_func_t)(const char *, const char *, size_t);
+typedef esp_err_t (*httpd_err_handler_func_t)(httpd_req_t *, httpd_err_code_t);
+
+typedef struct httpd_config {
+    uint16_t server_port;
+    uint16_t max_open_sockets;
+    uint16_t max_uri_handlers;
+    uint16_t recv_wait_timeout;
+    uint16_t send_wait_timeout;
+    bool lru_purge_enable;
+    httpd_uri_match_func_t uri_match_fn;
+} httpd_config_t;
+
+#define HTTPD_DEFAULT_CONFIG() { \
+    .server_port = 80, \
+    .max_open_sockets = 7, \
+    .max_uri_handlers = 8, \
+    .recv_wait_timeout = 5, \
+    .send_wait_timeout = 5, \
+    .lru_purge_enable = false, \
+    .uri_match_fn = NULL, \
+}
+
+esp_err_t httpd_start(httpd_handle_t *, const httpd_config_t *);
+esp_err_t httpd_stop(httpd_handle_t);
+esp_err_t httpd_register_uri_handler(httpd_handle_t, const httpd_uri_t *);
+esp_err_t httpd_register_err_handler(httpd_handle_t, httpd_err_code_t, httpd_err_handler_func_t);
+bool httpd_uri_match_wildcard(const char *, const char *, size_t);
+int httpd_req_recv(httpd_req_t *, char *, size_t);
+size_t httpd_req_get_hdr_value_len(httpd_req_t *, const char *);
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *, const char *, char *, size_t);
+esp_err_t httpd_resp_set_status(httpd_req_t *, const char *);
+esp_err_t httpd_resp_set_type(httpd_req_t *, const char *);
+esp_err_t httpd_resp_set_hdr(httpd_req_t *, const char *, const char *);
+esp_err_t httpd_resp_send(httpd_req_t *, const char *, ssize_t);
+esp_err_t httpd_resp_send_chunk(httpd_req_t *, const char *, ssize_t);
+esp_err_t httpd_resp_sendstr(httpd_req_t *, const char *);
+esp_err_t httpd_resp_sendstr_chunk(httpd_req_t *, const char *);
+esp_err_t httpd_resp_send_err(httpd_req_t *, httpd_err_code_t, const char *);
+
+// Not part of esp_http_server, port the n-th started server listens on.
+int httpd_port(int);
+// Not part of esp_http_server, sockets closed by the LRU purge.
+unsigned int httpd_purged();
+
+#endif
@@ -0,0 +1,7 @@
+// Stand-in for the load harness, see httpd.c.
+#ifndef _LOAD_TASK_H
+#define _LOAD_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+#endif
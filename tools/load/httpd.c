@@ -0,0 +1,461 @@
+// Minimal esp_http_server on local sockets: one thread per server serving one request at a time, at most
+// max_open_sockets connections with optional LRU purge, like the firmware server.
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+
+#include "esp_http_server.h"
+
+#define HTTPD_SERVERS 4
+#define HTTPD_HANDLERS 32
+#define HTTPD_SOCKETS 16
+#define HTTPD_HEADER 1024       // CONFIG_HTTPD_MAX_REQ_HDR_LEN
+#define HTTPD_EXTRA 8
+
+struct httpd_socket {
+    int fd;
+    unsigned long used;
+};
+
+struct httpd_aux {
+    int fd;
+    char header[HTTPD_HEADER + 1];
+    size_t header_len;
+    size_t pending;             // body bytes read along with the header
+    size_t pending_at;
+    size_t left;                // body bytes still on the socket
+    const char *status;
+    const char *type;
+    const char *extra[HTTPD_EXTRA][2];
+    unsigned char extras;
+    bool started;               // chunked response in progress
+    bool failed;
+};
+
+struct httpd_server {
+    int listener;
+    int port;
+    httpd_config_t config;
+    httpd_uri_t handlers[HTTPD_HANDLERS];
+    unsigned char count;
+    httpd_err_handler_func_t errors[HTTPD_ERR_CODE_MAX];
+    struct httpd_socket sockets[HTTPD_SOCKETS];
+    struct httpd_aux aux;
+    httpd_req_t req;
+    unsigned long clock;
+    pthread_t thread;
+    volatile bool stop;
+};
+
+static struct httpd_server servers[HTTPD_SERVERS];
+static volatile int started = 0;
+static unsigned int purged = 0;
+
+static const char *const statuses[HTTPD_ERR_CODE_MAX] = {
+    "500 Internal Server Error", "400 Bad Request", "404 Not Found", "405 Method Not Allowed",
+    "408 Request Timeout", "413 Content Too Large", "431 Request Header Fields Too Large"
+};
+
+static void *httpd_thread(void *);
+static bool httpd_serve(struct httpd_server *, int);
+static bool httpd_write(struct httpd_aux *, const char *, size_t);
+static bool httpd_head(httpd_req_t *, ssize_t);
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
+{
+    if (started == HTTPD_SERVERS || config->max_open_sockets > HTTPD_SOCKETS) {
+        return ESP_FAIL;
+    }
+    struct httpd_server *server = &servers[started];
+    memset(server, 0, sizeof(struct httpd_server));
+    server->config = *config;
+    // any free local port, the firmware port would need privileges
+    server->listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    socklen_t len = sizeof(addr);
+    if (server->listener < 0 || bind(server->listener, (struct sockaddr *)&addr, sizeof(addr)) ||
+        listen(server->listener, 64) || getsockname(server->listener, (struct sockaddr *)&addr, &len)) {
+        return ESP_FAIL;
+    }
+    server->port = ntohs(addr.sin_port);
+    for (int i = 0; i < HTTPD_SOCKETS; i++) {
+        server->sockets[i].fd = -1;
+    }
+    if (pthread_create(&server->thread, NULL, httpd_thread, server)) {
+        return ESP_FAIL;
+    }
+    started++;
+    *handle = server;
+    return ESP_OK;
+}
+
+esp_err_t httpd_stop(httpd_handle_t handle)
+{
+    struct httpd_server *server = handle;
+    server->stop = true;
+    pthread_join(server->thread, NULL);
+    close(server->listener);
+    for (int i = 0; i < HTTPD_SOCKETS; i++) {
+        if (server->sockets[i].fd >= 0) {
+            close(server->sockets[i].fd);
+        }
+    }
+    return ESP_OK;
+}
+
+int httpd_port(int index)
+{
+    return index < started ? servers[index].port : -1;
+}
+
+unsigned int httpd_purged()
+{
+    return purged;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri)
+{
+    struct httpd_server *server = handle;
+    if (server->count >= server->config.max_uri_handlers || server->count == HTTPD_HANDLERS) {
+        return ESP_FAIL;
+    }
+    server->handlers[server->count++] = *uri;
+    return ESP_OK;
+}
+
+esp_err_t httpd_register_err_handler(httpd_handle_t handle, httpd_err_code_t code, httpd_err_handler_func_t handler)
+{
+    ((struct httpd_server *)handle)->errors[code] = handler;
+    return ESP_OK;
+}
+
+// Same rules as the firmware: trailing * matches anything, trailing ? makes the last character optional.
+bool httpd_uri_match_wildcard(const char *pattern, const char *uri, size_t uri_len)
+{
+    size_t len = strlen(pattern);
+    bool wild = false, optional = false;
+    for (int i = 0; i < 2 && len; i++) {
+        if (pattern[len - 1] == '*' && !wild) {
+            wild = true;
+            len--;
+        } else if (pattern[len - 1] == '?' && !optional) {
+            optional = true;
+            len--;
+        }
+    }
+    if (optional && len && (uri_len == len - 1) && !strncmp(pattern, uri, uri_len)) {
+        return true;
+    }
+    if (wild) {
+        return uri_len >= len && !strncmp(pattern, uri, len);
+    }
+    return uri_len == len && !strncmp(pattern, uri, len);
+}
+
+int httpd_req_recv(httpd_req_t *req, char *buffer, size_t size)
+{
+    struct httpd_aux *aux = req->aux;
+    if (aux->pending) {
+        size_t count = size < aux->pending ? size : aux->pending;
+        memcpy(buffer, aux->header + aux->pending_at, count);
+        aux->pending -= count;
+        aux->pending_at += count;
+        return count;
+    }
+    if (!aux->left) {
+        return 0;
+    }
+    ssize_t received = recv(aux->fd, buffer, size < aux->left ? size : aux->left, 0);
+    if (received < 0) {
+        return errno == EAGAIN || errno == EWOULDBLOCK ? HTTPD_SOCK_ERR_TIMEOUT : HTTPD_SOCK_ERR_FAIL;
+    }
+    aux->left -= received;
+    return received;
+}
+
+size_t httpd_req_get_hdr_value_len(httpd_req_t *req, const char *field)
+{
+    struct httpd_aux *aux = req->aux;
+    size_t len = strlen(field);
+    for (const char *line = strstr(aux->header, "\r\n"); line && line[2] != '\r'; line = strstr(line + 2, "\r\n")) {
+        if (!strncasecmp(line + 2, field, len) && line[2 + len] == ':') {
+            const char *value = line + 3 + len;
+            value += strspn(value, " ");
+            return strcspn(value, "\r");
+        }
+    }
+    return 0;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *req, const char *field, char *value, size_t size)
+{
+    struct httpd_aux *aux = req->aux;
+    size_t len = strlen(field);
+    for (const char *line = strstr(aux->header, "\r\n"); line && line[2] != '\r'; line = strstr(line + 2, "\r\n")) {
+        if (!strncasecmp(line + 2, field, len) && line[2 + len] == ':') {
+            const char *start = line + 3 + len;
+            start += strspn(start, " ");
+            size_t found = strcspn(start, "\r");
+            size_t count = found < size - 1 ? found : size - 1;
+            memcpy(value, start, count);
+            value[count] = 0;
+            return found < size ? ESP_OK : ESP_FAIL;
+        }
+    }
+    return ESP_FAIL;
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t *req, const char *status)
+{
+    ((struct httpd_aux *)req->aux)->status = status;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *req, const char *type)
+{
+    ((struct httpd_aux *)req->aux)->type = type;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *req, const char *field, const char *value)
+{
+    struct httpd_aux *aux = req->aux;
+    if (aux->extras == HTTPD_EXTRA) {
+        return ESP_FAIL;
+    }
+    aux->extra[aux->extras][0] = field;
+    aux->extra[aux->extras++][1] = value;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *req, const char *buffer, ssize_t len)
+{
+    if (len == HTTPD_RESP_USE_STRLEN) {
+        len = buffer ? strlen(buffer) : 0;
+    }
+    if (!httpd_head(req, len) || !httpd_write(req->aux, buffer, len)) {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t *req, const char *buffer, ssize_t len)
+{
+    struct httpd_aux *aux = req->aux;
+    if (len == HTTPD_RESP_USE_STRLEN) {
+        len = buffer ? strlen(buffer) : 0;
+    }
+    if (!aux->started) {
+        if (!httpd_head(req, -1)) {
+            return ESP_FAIL;
+        }
+        aux->started = true;
+    }
+    char size[16];
+    int size_len = snprintf(size, sizeof(size), "%zx\r\n", (size_t)len);
+    if (!httpd_write(aux, size, size_len) || !httpd_write(aux, buffer, len) || !httpd_write(aux, "\r\n", 2)) {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_sendstr(httpd_req_t *req, const char *str)
+{
+    return httpd_resp_send(req, str, HTTPD_RESP_USE_STRLEN);
+}
+
+esp_err_t httpd_resp_sendstr_chunk(httpd_req_t *req, const char *str)
+{
+    return httpd_resp_send_chunk(req, str, str ? HTTPD_RESP_USE_STRLEN : 0);
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t code, const char *message)
+{
+    httpd_resp_set_status(req, statuses[code]);
+    httpd_resp_set_type(req, "text/html");
+    return httpd_resp_send(req, message, HTTPD_RESP_USE_STRLEN);
+}
+
+static void *httpd_thread(void *arg)
+{
+    struct httpd_server *server = arg;
+    while (!server->stop) {
+        fd_set set;
+        FD_ZERO(&set);
+        FD_SET(server->listener, &set);
+        int top = server->listener;
+        for (int i = 0; i < server->config.max_open_sockets; i++) {
+            if (server->sockets[i].fd >= 0) {
+                FD_SET(server->sockets[i].fd, &set);
+                top = server->sockets[i].fd > top ? server->sockets[i].fd : top;
+            }
+        }
+        struct timeval timeout = {.tv_sec = 0,.tv_usec = 100000 };
+        if (select(top + 1, &set, NULL, NULL, &timeout) <= 0) {
+            continue;
+        }
+        for (int i = 0; i < server->config.max_open_sockets; i++) {
+            struct httpd_socket *socket = &server->sockets[i];
+            if (socket->fd >= 0 && FD_ISSET(socket->fd, &set)) {
+                socket->used = ++server->clock;
+                if (!httpd_serve(server, socket->fd)) {
+                    close(socket->fd);
+                    socket->fd = -1;
+                }
+            }
+        }
+        if (!FD_ISSET(server->listener, &set)) {
+            continue;
+        }
+        int fd = accept(server->listener, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+        struct timeval wait = {.tv_sec = server->config.recv_wait_timeout };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &wait, sizeof(wait));
+        // headers and body go out in separate sends, keep the host delayed ack out of the latencies
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        struct httpd_socket *slot = NULL;
+        for (int i = 0; i < server->config.max_open_sockets; i++) {
+            if (server->sockets[i].fd < 0) {
+                slot = &server->sockets[i];
+                break;
+            }
+            if (!slot || server->sockets[i].used < slot->used) {
+                slot = &server->sockets[i];
+            }
+        }
+        if (slot->fd >= 0) {
+            if (!server->config.lru_purge_enable) {
+                close(fd);
+                continue;
+            }
+            close(slot->fd);
+            __atomic_add_fetch(&purged, 1, __ATOMIC_RELAXED);
+        }
+        slot->fd = fd;
+        slot->used = ++server->clock;
+    }
+    return NULL;
+}
+
+// Serve one request, false when the connection has to be closed.
+static bool httpd_serve(struct httpd_server *server, int fd)
+{
+    struct httpd_aux *aux = &server->aux;
+    memset(aux, 0, sizeof(struct httpd_aux));
+    aux->fd = fd;
+    aux->status = "200 OK";
+    aux->type = "text/html";
+    char *end = NULL;
+    while (!end) {
+        if (aux->header_len == HTTPD_HEADER) {
+            return false;
+        }
+        ssize_t received = recv(fd, aux->header + aux->header_len, HTTPD_HEADER - aux->header_len, 0);
+        if (received <= 0) {
+            return false;
+        }
+        aux->header_len += received;
+        aux->header[aux->header_len] = 0;
+        end = strstr(aux->header, "\r\n\r\n");
+    }
+    httpd_req_t *req = &server->req;
+    memset(req, 0, sizeof(httpd_req_t));
+    req->handle = server;
+    req->aux = aux;
+    char method[8];
+    if (sscanf(aux->header, "%7s %512s", method, (char *)req->uri) != 2) {
+        return false;
+    }
+    req->method = !strcmp(method, "GET") ? HTTP_GET : !strcmp(method, "POST") ? HTTP_POST :
+        !strcmp(method, "PUT") ? HTTP_PUT : 0;
+    char length[16];
+    if (httpd_req_get_hdr_value_str(req, "Content-Length", length, sizeof(length)) == ESP_OK) {
+        req->content_len = strtoul(length, NULL, 10);
+    }
+    aux->pending_at = end + 4 - aux->header;
+    aux->pending = aux->header_len - aux->pending_at;
+    if (aux->pending > req->content_len) {
+        aux->pending = req->content_len;
+    }
+    aux->left = req->content_len - aux->pending;
+    size_t uri_len = strcspn(req->uri, "?");
+    httpd_uri_t *found = NULL;
+    bool other = false;
+    for (unsigned char i = 0; i < server->count; i++) {
+        httpd_uri_t *handler = &server->handlers[i];
+        bool match = server->config.uri_match_fn ? server->config.uri_match_fn(handler->uri, req->uri, uri_len) :
+            strlen(handler->uri) == uri_len && !strncmp(handler->uri, req->uri, uri_len);
+        if (match && handler->method == req->method) {
+            found = handler;
+            break;
+        }
+        other |= match;
+    }
+    esp_err_t err;
+    if (found) {
+        req->user_ctx = found->user_ctx;
+        err = found->handler(req);
+    } else {
+        httpd_err_code_t code = other ? HTTPD_405_METHOD_NOT_ALLOWED : HTTPD_404_NOT_FOUND;
+        if (server->errors[code]) {
+            err = server->errors[code](req, code);
+        } else {
+            httpd_resp_send_err(req, code, statuses[code]);
+            err = ESP_FAIL;
+        }
+    }
+    // purge what the handler did not read, as the firmware does
+    char discard[256];
+    while (err == ESP_OK && !aux->failed && (aux->pending || aux->left)) {
+        if (httpd_req_recv(req, discard, sizeof(discard)) <= 0) {
+            return false;
+        }
+    }
+    return err == ESP_OK && !aux->failed;
+}
+
+static bool httpd_write(struct httpd_aux *aux, const char *buffer, size_t len)
+{
+    while (len && !aux->failed) {
+        ssize_t sent = send(aux->fd, buffer, len, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            aux->failed = true;
+            break;
+        }
+        buffer += sent;
+        len -= sent;
+    }
+    return !aux->failed;
+}
+
+// Status line and headers, chunked when len is negative.
+static bool httpd_head(httpd_req_t *req, ssize_t len)
+{
+    struct httpd_aux *aux = req->aux;
+    char head[512];
+    int head_len = snprintf(head, sizeof(head), "HTTP/1.1 %s\r\nContent-Type: %s\r\n", aux->status, aux->type);
+    if (len < 0) {
+        head_len += snprintf(head + head_len, sizeof(head) - head_len, "Transfer-Encoding: chunked\r\n");
+    } else {
+        head_len += snprintf(head + head_len, sizeof(head) - head_len, "Content-Length: %zd\r\n", len);
+    }
+    for (unsigned char i = 0; i < aux->extras; i++) {
+        head_len += snprintf(head + head_len, sizeof(head) - head_len, "%s: %s\r\n", aux->extra[i][0],
+                             aux->extra[i][1]);
+    }
+    head_len += snprintf(head + head_len, sizeof(head) - head_len, "\r\n");
+    return httpd_write(aux, head, head_len);
+}
@@ -0,0 +1,569 @@
+// Load and soak the firmware http handlers on the host:
+// cc -O2 -pthread -DBODY_BUFFERS=2 -I. -I../sim -I../../main -I$IDF_PATH/components/json/cJSON -Wa,-I../../main
+//   -Wl,--wrap=malloc,--wrap=free,--wrap=calloc,--wrap=realloc -o load load.c httpd.c
+//   ../../main/{alarm,setup,form,body}.c $IDF_PATH/components/json/cJSON/cJSON.c
+// ./load 8 60 baseline > baseline.json
+// The alarm and setup servers run their firmware handlers behind the esp_http_server stand-in of httpd.c, with the
+// same socket limits. Both servers run at once here, unlike on the device, so the body pool has a buffer for each.
+// Clients keep their connections open and cycle through home pages, colour and setup posts, oversized and truncated
+// bodies. The result goes to stdout as one json document, progress to stderr.
+#include <errno.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "alarm.h"
+#include "setup.h"
+#include "data.h"
+#include "engine.h"
+#include "light.h"
+#include "latency.h"
+#include "power.h"
+#include "resume.h"
+#include "api.h"
+#include "ota.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_http_server.h"
+
+// EMBED_FILES of the firmware build
+__asm__(".section .rodata\n"
+        ".global _binary_alarm_html_start\n_binary_alarm_html_start:\n.incbin \"alarm.html\"\n"
+        ".global _binary_alarm_html_end\n_binary_alarm_html_end:\n"
+        ".global _binary_setup_html_start\n_binary_setup_html_start:\n.incbin \"setup.html\"\n"
+        ".global _binary_setup_html_end\n_binary_setup_html_end:\n" ".previous");
+
+#define LOAD_CLIENTS 64
+#define LOAD_STATUS 600
+#define LOAD_RESPONSE 65536
+
+enum load_scenario {
+    LOAD_ALARM_HOME,
+    LOAD_SETUP_HOME,
+    LOAD_COLOUR,
+    LOAD_SETUP,
+    LOAD_OVERSIZED,
+    LOAD_TRUNCATED,
+    LOAD_SCENARIOS
+};
+
+static const char *const load_names[LOAD_SCENARIOS] = {
+    "alarm_home", "setup_home", "colour", "setup", "oversized", "truncated"
+};
+
+struct load_result {
+    unsigned int *latency;      // microseconds
+    size_t count;
+    size_t size;
+    unsigned int status[LOAD_STATUS];
+    unsigned int errors;
+};
+
+struct load_client {
+    pthread_t thread;
+    unsigned int seed;
+    int fd[2];                  // alarm, setup connection
+    struct load_result results[LOAD_SCENARIOS];
+};
+
+struct load_reader {
+    int fd;
+    char buffer[4096];
+    size_t len;
+    size_t at;
+};
+
+struct sim_semaphore {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool given;
+};
+
+static struct data data;
+static SemaphoreHandle_t signal_setup;
+static struct load_client clients[LOAD_CLIENTS];
+static int ports[2];
+static volatile bool stop = false;
+static volatile unsigned long requests = 0;
+
+static size_t heap_current = 0;
+static size_t heap_peak = 0;
+static unsigned long heap_allocations = 0;
+
+void *__real_malloc(size_t);
+void __real_free(void *);
+void *__real_calloc(size_t, size_t);
+void *__real_realloc(void *, size_t);
+
+static void *load_alarm(void *);
+static void *load_client(void *);
+static int load_request(struct load_client *, enum load_scenario);
+static int load_connect(int);
+static bool load_send(int, const char *, size_t);
+static int load_response(int);
+static bool load_line(struct load_reader *, char *, size_t);
+static bool load_skip(struct load_reader *, size_t);
+static void load_record(struct load_result *, unsigned int);
+static int load_compare(const void *, const void *);
+static long long load_now();
+static void load_heap(void *, bool);
+
+int main(int argc, char **argv)
+{
+    int count = argc > 1 ? atoi(argv[1]) : 8;
+    int seconds = argc > 2 ? atoi(argv[2]) : 10;
+    const char *label = argc > 3 ? argv[3] : "";
+    if (count < 1 || count > LOAD_CLIENTS || seconds < 1) {
+        fprintf(stderr, "usage: %s [clients 1-%d] [seconds] [label]\n", argv[0], LOAD_CLIENTS);
+        return 1;
+    }
+    const char *err;
+    signal_setup = xSemaphoreCreateBinary();
+    if ((err = setup_server("http://192.168.4.1/", &data, &signal_setup))) {
+        fprintf(stderr, "%s\n", err);
+        return 1;
+    }
+    pthread_t alarm;
+    pthread_create(&alarm, NULL, load_alarm, NULL);
+    while (httpd_port(1) < 0) {
+        usleep(1000);
+    }
+    ports[0] = httpd_port(1);
+    ports[1] = httpd_port(0);
+    size_t heap_start = __atomic_load_n(&heap_current, __ATOMIC_RELAXED);
+    long long start = load_now();
+    for (int i = 0; i < count; i++) {
+        clients[i].seed = i + 1;
+        clients[i].fd[0] = clients[i].fd[1] = -1;
+        pthread_create(&clients[i].thread, NULL, load_client, &clients[i]);
+    }
+    for (int elapsed = 1; elapsed <= seconds; elapsed++) {
+        sleep(1);
+        if (!(elapsed % 10) || elapsed == seconds) {
+            fprintf(stderr, "%ds %lu requests, heap %zu\n", elapsed, requests, heap_current);
+        }
+    }
+    stop = true;
+    for (int i = 0; i < count; i++) {
+        pthread_join(clients[i].thread, NULL);
+    }
+    double elapsed = (load_now() - start) / 1e6;
+    printf("{\"label\":\"%s\",\"clients\":%d,\"seconds\":%.3f,\"requests\":%lu,\"rps\":%.1f,", label, count,
+           elapsed, requests, requests / elapsed);
+    printf("\"heap\":{\"start\":%zu,\"current\":%zu,\"peak\":%zu,\"allocations\":%lu},\"purged\":%u,\"scenarios\":{",
+           heap_start, heap_current, heap_peak, heap_allocations, httpd_purged());
+    for (int scenario = 0; scenario < LOAD_SCENARIOS; scenario++) {
+        struct load_result total = { 0 };
+        for (int i = 0; i < count; i++) {
+            struct load_result *result = &clients[i].results[scenario];
+            for (size_t j = 0; j < result->count; j++) {
+                load_record(&total, result->latency[j]);
+            }
+            for (int code = 0; code < LOAD_STATUS; code++) {
+                total.status[code] += result->status[code];
+            }
+            total.errors += result->errors;
+        }
+        qsort(total.latency, total.count, sizeof(unsigned int), load_compare);
+#define LOAD_PERCENTILE(p) (total.count ? total.latency[(total.count - 1) * p / 100] : 0)
+        printf("%s\"%s\":{\"requests\":%zu,\"p50_us\":%u,\"p90_us\":%u,\"p99_us\":%u,\"max_us\":%u,\"errors\":%u,"
+               "\"status\":{", scenario ? "," : "", load_names[scenario], total.count, LOAD_PERCENTILE(50),
+               LOAD_PERCENTILE(90), LOAD_PERCENTILE(99), LOAD_PERCENTILE(100), total.errors);
+#undef LOAD_PERCENTILE
+        bool first = true;
+        for (int code = 0; code < LOAD_STATUS; code++) {
+            if (total.status[code]) {
+                printf("%s\"%d\":%u", first ? "" : ",", code, total.status[code]);
+                first = false;
+            }
+        }
+        printf("}}");
+        __real_free(total.latency);
+    }
+    printf("}}\n");
+    return 0;
+}
+
+static void *load_alarm(void *arg)
+{
+    const char *err = alarm_start(&data);
+    fprintf(stderr, "%s\n", err);
+    exit(1);
+}
+
+static void *load_client(void *arg)
+{
+    struct load_client *client = arg;
+    while (!stop) {
+        enum load_scenario scenario = rand_r(&client->seed) % LOAD_SCENARIOS;
+        long long start = load_now();
+        int status = load_request(client, scenario);
+        struct load_result *result = &client->results[scenario];
+        if (status > 0 && status < LOAD_STATUS) {
+            result->status[status]++;
+            load_record(result, load_now() - start);
+        } else {
+            result->errors++;
+        }
+        __atomic_add_fetch(&requests, 1, __ATOMIC_RELAXED);
+    }
+    for (int i = 0; i < 2; i++) {
+        if (client->fd[i] >= 0) {
+            close(client->fd[i]);
+        }
+    }
+    return NULL;
+}
+
+// Status code of the response, -1 when the connection failed or closed before one.
+static int load_request(struct load_client *client, enum load_scenario scenario)
+{
+    int server = scenario == LOAD_SETUP_HOME || scenario == LOAD_SETUP;
+    char request[512];
+    char body[128];
+    int len = 0;
+    switch (scenario) {
+    case LOAD_ALARM_HOME:
+    case LOAD_SETUP_HOME:
+        len = snprintf(request, sizeof(request), "GET / HTTP/1.1\r\nHost: alarm\r\n\r\n");
+        break;
+    case LOAD_COLOUR:
+        snprintf(body, sizeof(body), "{\"color\":%d,\"brightness\":%d}", rand_r(&client->seed) % 216,
+                 rand_r(&client->seed) % 256);
+        len = snprintf(request, sizeof(request), "POST / HTTP/1.1\r\nHost: alarm\r\nContent-Type: application/json\r\n"
+                       "Content-Length: %zu\r\n\r\n%s", strlen(body), body);
+        break;
+    case LOAD_SETUP:
+        snprintf(body, sizeof(body), "ssid=load%%20%u&password=secret%u&timezone=CET-1CEST%%2CM3.5.0%%2CM10.5.0%%2F3",
+                 rand_r(&client->seed) % 100, rand_r(&client->seed) % 100);
+        len = snprintf(request, sizeof(request), "POST / HTTP/1.1\r\nHost: alarm\r\n"
+                       "Content-Type: application/x-www-form-urlencoded\r\nContent-Length: %zu\r\n\r\n%s",
+                       strlen(body), body);
+        break;
+    case LOAD_OVERSIZED:
+        // refused on the header, the body is never sent
+        len = snprintf(request, sizeof(request), "POST / HTTP/1.1\r\nHost: alarm\r\nContent-Length: 8192\r\n\r\n");
+        break;
+    case LOAD_TRUNCATED:
+        len = snprintf(request, sizeof(request), "POST / HTTP/1.1\r\nHost: alarm\r\nContent-Length: 100\r\n\r\n"
+                       "{\"color\":42,\"brig");
+        break;
+    default:
+        return -1;
+    }
+    int *fd = &client->fd[server];
+    if (*fd < 0 && (*fd = load_connect(ports[server])) < 0) {
+        return -1;
+    }
+    // a purged connection shows up as a failed send or an empty response
+    int status = -1;
+    if (load_send(*fd, request, len)) {
+        if (scenario == LOAD_TRUNCATED) {
+            shutdown(*fd, SHUT_WR);
+        }
+        status = load_response(*fd);
+    }
+    if (status < 0 || scenario == LOAD_OVERSIZED || scenario == LOAD_TRUNCATED) {
+        close(*fd);
+        *fd = -1;
+    }
+    return status;
+}
+
+static int load_connect(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    struct timeval timeout = {.tv_sec = 10 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool load_send(int fd, const char *buffer, size_t len)
+{
+    while (len) {
+        ssize_t sent = send(fd, buffer, len, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            return false;
+        }
+        buffer += sent;
+        len -= sent;
+    }
+    return true;
+}
+
+// Read a whole response, by content length or chunks.
+static int load_response(int fd)
+{
+    static __thread struct load_reader reader;
+    reader.fd = fd;
+    reader.len = reader.at = 0;
+    char line[256];
+    int status;
+    if (!load_line(&reader, line, sizeof(line)) || sscanf(line, "HTTP/1.%*d %d", &status) != 1) {
+        return -1;
+    }
+    long length = -1;
+    bool chunked = false;
+    for (;;) {
+        if (!load_line(&reader, line, sizeof(line))) {
+            return -1;
+        }
+        if (!*line) {
+            break;
+        }
+        if (!strncasecmp(line, "Content-Length:", 15)) {
+            length = atol(line + 15);
+        } else if (!strncasecmp(line, "Transfer-Encoding:", 18) && strstr(line, "chunked")) {
+            chunked = true;
+        }
+    }
+    if (!chunked) {
+        return length >= 0 && length <= LOAD_RESPONSE && load_skip(&reader, length) ? status : -1;
+    }
+    for (;;) {
+        if (!load_line(&reader, line, sizeof(line))) {
+            return -1;
+        }
+        size_t size = strtoul(line, NULL, 16);
+        if (!load_skip(&reader, size) || !load_line(&reader, line, sizeof(line))) {
+            return -1;
+        }
+        if (!size) {
+            return status;
+        }
+    }
+}
+
+static bool load_fill(struct load_reader *reader)
+{
+    if (reader->at == reader->len) {
+        reader->at = reader->len = 0;
+    }
+    ssize_t received = recv(reader->fd, reader->buffer + reader->len, sizeof(reader->buffer) - reader->len, 0);
+    if (received <= 0) {
+        return false;
+    }
+    reader->len += received;
+    return true;
+}
+
+static bool load_line(struct load_reader *reader, char *line, size_t size)
+{
+    size_t len = 0;
+    for (;;) {
+        while (reader->at < reader->len) {
+            char current = reader->buffer[reader->at++];
+            if (current == '\n') {
+                line[len && line[len - 1] == '\r' ? len - 1 : len] = 0;
+                return true;
+            }
+            if (len < size - 1) {
+                line[len++] = current;
+            }
+        }
+        if (!load_fill(reader)) {
+            return false;
+        }
+    }
+}
+
+static bool load_skip(struct load_reader *reader, size_t size)
+{
+    for (;;) {
+        size_t available = reader->len - reader->at;
+        if (available >= size) {
+            reader->at += size;
+            return true;
+        }
+        size -= available;
+        reader->at = reader->len;
+        if (!load_fill(reader)) {
+            return false;
+        }
+    }
+}
+
+static void load_record(struct load_result *result, unsigned int latency)
+{
+    if (result->count == result->size) {
+        result->size = result->size ? result->size * 2 : 1024;
+        result->latency = __real_realloc(result->latency, result->size * sizeof(unsigned int));
+        if (!result->latency) {
+            fprintf(stderr, "Unable to allocate latency samples.\n");
+            exit(1);
+        }
+    }
+    result->latency[result->count++] = latency;
+}
+
+static int load_compare(const void *a, const void *b)
+{
+    unsigned int left = *(const unsigned int *)a, right = *(const unsigned int *)b;
+    return (left > right) - (left < right);
+}
+
+static long long load_now()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000LL + now.tv_nsec / 1000;
+}
+
+// Allocator high-water mark of the handler and cJSON code, the harness itself calls the real allocator.
+static void load_heap(void *pointer, bool allocated)
+{
+    if (!pointer) {
+        return;
+    }
+    size_t size = malloc_usable_size(pointer);
+    if (!allocated) {
+        __atomic_sub_fetch(&heap_current, size, __ATOMIC_RELAXED);
+        return;
+    }
+    __atomic_add_fetch(&heap_allocations, 1, __ATOMIC_RELAXED);
+    size_t current = __atomic_add_fetch(&heap_current, size, __ATOMIC_RELAXED);
+    size_t peak = __atomic_load_n(&heap_peak, __ATOMIC_RELAXED);
+    while (current > peak && !__atomic_compare_exchange_n(&heap_peak, &peak, current, true, __ATOMIC_RELAXED,
+                                                          __ATOMIC_RELAXED)) ;
+}
+
+void *__wrap_malloc(size_t size)
+{
+    void *pointer = __real_malloc(size);
+    load_heap(pointer, true);
+    return pointer;
+}
+
+void __wrap_free(void *pointer)
+{
+    load_heap(pointer, false);
+    __real_free(pointer);
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+    void *pointer = __real_calloc(count, size);
+    load_heap(pointer, true);
+    return pointer;
+}
+
+void *__wrap_realloc(void *pointer, size_t size)
+{
+    load_heap(pointer, false);
+    void *resized = __real_realloc(pointer, size);
+    load_heap(resized ? resized : pointer, true);
+    return resized;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+    SemaphoreHandle_t semaphore = __real_calloc(1, sizeof(struct sim_semaphore));
+    if (semaphore) {
+        pthread_mutex_init(&semaphore->lock, NULL);
+        pthread_cond_init(&semaphore->cond, NULL);
+    }
+    return semaphore;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks)
+{
+    struct timespec until;
+    clock_gettime(CLOCK_REALTIME, &until);
+    long long nanoseconds = until.tv_nsec + (long long)ticks * (1000000000LL / configTICK_RATE_HZ);
+    until.tv_sec += nanoseconds / 1000000000LL;
+    until.tv_nsec = nanoseconds % 1000000000LL;
+    pthread_mutex_lock(&semaphore->lock);
+    while (!semaphore->given && pthread_cond_timedwait(&semaphore->cond, &semaphore->lock, &until) != ETIMEDOUT) ;
+    BaseType_t taken = semaphore->given ? pdTRUE : pdFALSE;
+    semaphore->given = false;
+    pthread_mutex_unlock(&semaphore->lock);
+    return taken;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    pthread_mutex_lock(&semaphore->lock);
+    semaphore->given = true;
+    pthread_cond_signal(&semaphore->cond);
+    pthread_mutex_unlock(&semaphore->lock);
+    return pdTRUE;
+}
+
+// Firmware pieces outside of the http handlers.
+const char *engine_init()
+{
+    return NULL;
+}
+
+void engine_run(struct data *data, void *signal)
+{
+    for (;;) {
+        xSemaphoreTake(*(SemaphoreHandle_t *) signal, portMAX_DELAY);
+    }
+}
+
+void light_set(unsigned char colour, unsigned char brightness)
+{
+}
+
+void latency_cause(enum latency_cause cause, bool active)
+{
+}
+
+const char *latency_register(void *server)
+{
+    return NULL;
+}
+
+const char *power_init()
+{
+    return NULL;
+}
+
+void power_hold(enum power_holder holder, bool active)
+{
+}
+
+const char *power_register(void *server)
+{
+    return NULL;
+}
+
+esp_err_t power_route(void *server, const void *uri)
+{
+    return httpd_register_uri_handler(server, uri);
+}
+
+const char *api_register(void *server, struct data *data, void *signal)
+{
+    return NULL;
+}
+
+const char *ota_register(void *server)
+{
+    return NULL;
+}
+
+void resume_stop()
+{
+}
@@ -0,0 +1,279 @@
+// Benchmark the alarm queue against a scan of every alarm and cross-check both, on the host:
+// cc -O2 -DDATA_ALARMS=512 -I../main -o schedule schedule.c ../main/{schedule,zone}.c && ./schedule 500 2026-03-01 14
+// Random weekly alarms, one-shot alarms and dates off are stepped through like the engine does, then checked against
+// the scan at random instants with edits, appends and removals in between. Occurrences stay shorter than a day. Local
+// time follows the rules in TZ, UTC without.
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "data.h"
+#include "schedule.h"
+#include "zone.h"
+
+#define SCHEDULE_CHECKS 20000
+#define SCHEDULE_SCAN_WAIT 3600
+
+static struct data data;
+static struct schedule_queue queue;
+
+static void schedule_random(struct alarm *, time_t, int);
+static time_t schedule_scan(const struct data *, time_t, struct schedule *);
+static void schedule_candidate(struct schedule *, time_t *, time_t, const struct schedule *);
+static bool schedule_same(const struct schedule *, time_t, const struct schedule *, time_t);
+static double schedule_elapsed(const struct timespec *, const struct timespec *);
+
+int main(int argc, char **argv)
+{
+    if (argc != 4) {
+        fprintf(stderr, "Usage: %s <alarms> <YYYY-MM-DD> <days>\n", argv[0]);
+        return 1;
+    }
+    int count = atoi(argv[1]);
+    int days = atoi(argv[3]);
+    struct tm tm = { 0 };
+    if (count < 1 || count > DATA_ALARMS || days < 1 ||
+        sscanf(argv[2], "%d-%d-%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday) != 3) {
+        fprintf(stderr, "Between 1 and %d alarms, a start date and at least a day.\n", DATA_ALARMS);
+        return 1;
+    }
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    tm.tm_isdst = -1;
+    const char *tz = getenv("TZ");
+    zone_set(tz ? tz : "");
+    time_t start = zone_epoch(&tm);
+    time_t end = start + days * 86400;
+    srand(1);
+    data.alarms = count;
+    for (int i = 0; i < count; i++) {
+        schedule_random(&data.alarm[i], start, days);
+    }
+
+    // stepping along like the engine, once with the queue and once with the scan
+    struct timespec begin, stop;
+    struct schedule schedule;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    schedule_build(&queue, &data, start);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    double build = schedule_elapsed(&begin, &stop);
+    unsigned int steps = 0;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (time_t now = start; now < end; steps++) {
+        now += schedule_find(&queue, &data, now, &schedule);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    double find = schedule_elapsed(&begin, &stop) / steps;
+    unsigned int scans = 0;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (time_t now = start; now < end && scans < steps / 16 + 1; scans++) {
+        now += schedule_scan(&data, now, &schedule);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    double scan = schedule_elapsed(&begin, &stop) / scans;
+    volatile time_t next = 0;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (unsigned int i = 0; i < 1000000; i++) {
+        next += schedule_next(&queue);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    double peek = schedule_elapsed(&begin, &stop) / 1000000;
+
+    // random instants in order with edits in between, every answer must match the scan
+    schedule_build(&queue, &data, start);
+    unsigned int mismatches = 0, updates = 0, removals = 0;
+    double update = 0, removal = 0;
+    time_t now = start;
+    for (unsigned int i = 0; i < SCHEDULE_CHECKS && now < end; i++) {
+        now += rand() % (2 * (end - start) / SCHEDULE_CHECKS + 1);
+        int action = rand() % 8;
+        int index = rand() % data.alarms;
+        clock_gettime(CLOCK_MONOTONIC, &begin);
+        if (action == 0 && data.alarms > 1) {
+            data.alarms--;
+            memmove(&data.alarm[index], &data.alarm[index + 1], (data.alarms - index) * sizeof(struct alarm));
+            schedule_remove(&queue, &data, index, now);
+            clock_gettime(CLOCK_MONOTONIC, &stop);
+            removal += schedule_elapsed(&begin, &stop);
+            removals++;
+        } else if (action < 3) {
+            if (action == 1 && data.alarms < DATA_ALARMS) {
+                index = data.alarms++;
+            }
+            schedule_random(&data.alarm[index], now, days);
+            clock_gettime(CLOCK_MONOTONIC, &begin);
+            schedule_update(&queue, &data, index, now);
+            clock_gettime(CLOCK_MONOTONIC, &stop);
+            update += schedule_elapsed(&begin, &stop);
+            updates++;
+        }
+        struct schedule expected;
+        time_t wait = schedule_find(&queue, &data, now, &schedule);
+        time_t scanned = schedule_scan(&data, now, &expected);
+        if (!schedule_same(&schedule, wait, &expected, scanned)) {
+            if (mismatches++ < 10) {
+                fprintf(stderr, "%lld: queue phase %u alarm %u start %lld wait %lld, scan phase %u alarm %u start %lld "
+                        "wait %lld\n", (long long)now, schedule.phase, schedule.alarm, (long long)schedule.start,
+                        (long long)wait, expected.phase, expected.alarm, (long long)expected.start,
+                        (long long)scanned);
+            }
+        }
+    }
+    printf("%d alarms over %d days: build %.1f us, %u steps at %.2f us against %.1f us scanning, next %.1f ns, "
+           "update %.2f us, remove %.2f us, %u mismatches (%lld)\n", count, days, build / 1e3, steps, find / 1e3,
+           scan / 1e3, peek, updates ? update / updates / 1e3 : 0, removals ? removal / removals / 1e3 : 0, mismatches,
+           (long long)next);
+    return mismatches ? 1 : 0;
+}
+
+// Mostly weekly alarms, some one-shot ones and dates off within the span.
+static void schedule_random(struct alarm *alarm, time_t start, int days)
+{
+    memset(alarm, 0, sizeof(struct alarm));
+    alarm->hour = rand() % 24;
+    alarm->minute = rand() % 60;
+    alarm->repeat = (rand() % 10 ? SCHEDULE_ENABLED : 0) | rand() % 128;
+    alarm->volume = 96;
+    alarm->sunrise_time = rand() % 60;
+    alarm->sunrise_brightness = rand() % 256;
+    alarm->ring_time = rand() % 60;
+    alarm->sleep_time = rand() % 150;
+    alarm->sleep_aid_time = rand() % 60;
+    alarm->sleep_aid_brightness = rand() % 256;
+    alarm->sleep_aid_fade = rand() % 50;
+    alarm->sleep_aid_colour = rand() % 216;
+    alarm->pre_sleep_aid_time = rand() % 200;
+    alarm->pre_sleep_aid_brightness = rand() % 256;
+    alarm->pre_sleep_aid_fade = rand() % 60;
+    alarm->pre_sleep_aid_colour = rand() % 216;
+    int kind = rand() % 10;
+    if (kind < 7) {
+        return;
+    }
+    time_t noon = start + (rand() % (days + 2)) * 86400;
+    struct tm tm;
+    zone_local(noon, &tm);
+    alarm->year = tm.tm_year - 100;
+    alarm->month = tm.tm_mon + 1;
+    alarm->day = tm.tm_mday;
+    if (kind == 9) {
+        alarm->repeat = SCHEDULE_ENABLED | SCHEDULE_DAY_OFF;
+    }
+}
+
+// Every phase of every alarm around now, the way the engine looked before the queue.
+static time_t schedule_scan(const struct data *data, time_t now, struct schedule *schedule)
+{
+    time_t next = now + SCHEDULE_SCAN_WAIT;
+    memset(schedule, 0, sizeof(struct schedule));
+    struct tm today;
+    zone_local(now, &today);
+    for (unsigned short i = 0; i < data->alarms; i++) {
+        const struct alarm *alarm = &data->alarm[i];
+        if (!(alarm->repeat & SCHEDULE_ENABLED) || (alarm->year && alarm->repeat & SCHEDULE_DAY_OFF)) {
+            continue;
+        }
+        // one-shot alarms once on their date
+        for (int day = alarm->year ? 0 : -1; day <= (alarm->year ? 0 : 2); day++) {
+            struct tm tm = today;
+            if (alarm->year) {
+                tm.tm_year = alarm->year + 100;
+                tm.tm_mon = alarm->month - 1;
+                tm.tm_mday = alarm->day;
+            } else {
+                tm.tm_mday += day;
+            }
+            tm.tm_hour = alarm->hour;
+            tm.tm_min = alarm->minute;
+            tm.tm_sec = 0;
+            tm.tm_isdst = -1;
+            time_t wake = zone_epoch(&tm);
+            if (wake == -1 || (!alarm->year && !(alarm->repeat & (1 << tm.tm_wday)))) {
+                continue;
+            }
+            bool off = false;
+            for (unsigned short j = 0; j < data->alarms && !alarm->year && !off; j++) {
+                const struct alarm *other = &data->alarm[j];
+                off = other->year && (other->repeat & (SCHEDULE_ENABLED | SCHEDULE_DAY_OFF)) ==
+                    (SCHEDULE_ENABLED | SCHEDULE_DAY_OFF) && other->year == tm.tm_year - 100 &&
+                    other->month == tm.tm_mon + 1 && other->day == tm.tm_mday;
+            }
+            if (off) {
+                continue;
+            }
+            time_t bed = wake - alarm->sleep_time * 300;
+            struct schedule candidate = {
+                .phase = SCHEDULE_RING,
+                .alarm = i,
+                .start = wake,
+                .duration = alarm->ring_time * 60,
+                .colour = SCHEDULE_SUNRISE_COLOUR,
+                .brightness = alarm->sunrise_brightness
+            };
+            schedule_candidate(schedule, &next, now, &candidate);
+            candidate.phase = SCHEDULE_SUNRISE;
+            candidate.start = wake - alarm->sunrise_time * 60;
+            candidate.duration = alarm->sunrise_time * 60;
+            schedule_candidate(schedule, &next, now, &candidate);
+            candidate.phase = SCHEDULE_SLEEP_AID;
+            candidate.start = bed;
+            candidate.duration = alarm->sleep_aid_time * 60;
+            candidate.fade = alarm->sleep_aid_fade * 5;
+            candidate.colour = alarm->sleep_aid_colour;
+            candidate.brightness = alarm->sleep_aid_brightness;
+            schedule_candidate(schedule, &next, now, &candidate);
+            candidate.phase = SCHEDULE_PRE_SLEEP_AID;
+            candidate.start = bed - alarm->pre_sleep_aid_time * 60;
+            candidate.duration = alarm->pre_sleep_aid_time * 60;
+            candidate.fade = alarm->pre_sleep_aid_fade * 5;
+            candidate.colour = alarm->pre_sleep_aid_colour;
+            candidate.brightness = alarm->pre_sleep_aid_brightness;
+            schedule_candidate(schedule, &next, now, &candidate);
+        }
+    }
+    if (schedule->phase == SCHEDULE_SUNRISE ||
+        (schedule->phase != SCHEDULE_IDLE && now >= schedule->start + schedule->duration - schedule->fade)) {
+        return 1;
+    }
+    return next - now;
+}
+
+static void schedule_candidate(struct schedule *schedule, time_t *next, time_t now, const struct schedule *candidate)
+{
+    if (!candidate->duration) {
+        return;
+    }
+    time_t end = candidate->start + candidate->duration;
+    if (candidate->start > now) {
+        if (candidate->start < *next) {
+            *next = candidate->start;
+        }
+        return;
+    }
+    if (end <= now) {
+        return;
+    }
+    if (end < *next) {
+        *next = end;
+    }
+    if (candidate->fade && end - candidate->fade > now && end - candidate->fade < *next) {
+        *next = end - candidate->fade;
+    }
+    if (candidate->phase > schedule->phase ||
+        (candidate->phase == schedule->phase && candidate->alarm < schedule->alarm)) {
+        *schedule = *candidate;
+    }
+}
+
+static bool schedule_same(const struct schedule *schedule, time_t wait, const struct schedule *expected,
+                          time_t scanned)
+{
+    return wait == scanned && !memcmp(schedule, expected, sizeof(struct schedule));
+}
+
+static double schedule_elapsed(const struct timespec *start, const struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
@@ -0,0 +1,37 @@
+// Stand-in for the simulator, see sim.c.
+#ifndef _SIM_LEDC_H
+#define _SIM_LEDC_H
+
+#include "esp_err.h"
+
+typedef enum { LEDC_LOW_SPEED_MODE } ledc_mode_t;
+typedef enum { LEDC_TIMER_8_BIT = 8 } ledc_timer_bit_t;
+typedef enum { LEDC_TIMER_0 } ledc_timer_t;
+typedef enum { LEDC_CHANNEL_0, LEDC_CHANNEL_1, LEDC_CHANNEL_2, LEDC_CHANNEL_MAX } ledc_channel_t;
+typedef enum { LEDC_AUTO_CLK } ledc_clk_cfg_t;
+typedef enum { LEDC_INTR_DISABLE } ledc_intr_type_t;
+
+typedef struct {
+    ledc_mode_t speed_mode;
+    ledc_timer_bit_t duty_resolution;
+    ledc_timer_t timer_num;
+    uint32_t freq_hz;
+    ledc_clk_cfg_t clk_cfg;
+} ledc_timer_config_t;
+
+typedef struct {
+    int gpio_num;
+    ledc_mode_t speed_mode;
+    ledc_channel_t channel;
+    ledc_intr_type_t intr_type;
+    ledc_timer_t timer_sel;
+    uint32_t duty;
+    int hpoint;
+} ledc_channel_config_t;
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t *);
+esp_err_t ledc_channel_config(const ledc_channel_config_t *);
+esp_err_t ledc_set_duty(ledc_mode_t, ledc_channel_t, uint32_t);
+esp_err_t ledc_update_duty(ledc_mode_t, ledc_channel_t);
+
+#endif
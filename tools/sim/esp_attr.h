@@ -0,0 +1,7 @@
+// Stand-in for the simulator, see sim.c: RTC memory is a section the simulated resets leave alone.
+#ifndef _SIM_ESP_ATTR_H
+#define _SIM_ESP_ATTR_H
+
+#define RTC_NOINIT_ATTR __attribute__((section("rtc_noinit")))
+
+#endif
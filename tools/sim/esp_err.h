@@ -0,0 +1,16 @@
+// Stand-in for the simulator, see sim.c.
+#ifndef _SIM_ESP_ERR_H
+#define _SIM_ESP_ERR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+
+#endif
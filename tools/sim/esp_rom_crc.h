@@ -0,0 +1,9 @@
+// Stand-in for the simulator, see sim.c.
+#ifndef _SIM_ESP_ROM_CRC_H
+#define _SIM_ESP_ROM_CRC_H
+
+#include <stdint.h>
+
+uint32_t esp_rom_crc32_le(uint32_t, const uint8_t *, uint32_t);
+
+#endif
@@ -0,0 +1,9 @@
+// Stand-in for the simulator, see sim.c.
+#ifndef _SIM_ESP_RTC_TIME_H
+#define _SIM_ESP_RTC_TIME_H
+
+#include <stdint.h>
+
+uint64_t esp_rtc_get_time_us();
+
+#endif
@@ -0,0 +1,23 @@
+// Stand-in for the simulator, see sim.c.
+#ifndef _SIM_FREERTOS_H
+#define _SIM_FREERTOS_H
+
+#include "esp_err.h"
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef struct sim_semaphore *SemaphoreHandle_t;
+
+#define configTICK_RATE_HZ 100
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((TickType_t)(ms) * (TickType_t)configTICK_RATE_HZ) / (TickType_t)1000U))
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFF)
+#define pdTRUE 1
+#define pdFALSE 0
+
+// spinning, the load harness serves from several threads
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) while (__atomic_exchange_n((mux), 1, __ATOMIC_ACQUIRE))
+#define portEXIT_CRITICAL(mux) __atomic_store_n((mux), 0, __ATOMIC_RELEASE)
+
+#endif
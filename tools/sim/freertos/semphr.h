@@ -0,0 +1,12 @@
+// Stand-in for the simulator, see sim.c.
+#ifndef _SIM_SEMPHR_H
+#define _SIM_SEMPHR_H
+
+#include "freertos/FreeRTOS.h"
+
+SemaphoreHandle_t xSemaphoreCreateBinary();
+SemaphoreHandle_t xSemaphoreCreateMutex();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t);
+
+#endif
@@ -0,0 +1,24 @@
+// Stand-in for the simulator, see sim.c.
+#ifndef _SIM_NVS_FLASH_H
+#define _SIM_NVS_FLASH_H
+
+#include "esp_err.h"
+
+typedef uint32_t nvs_handle_t;
+typedef enum { NVS_READONLY, NVS_READWRITE } nvs_open_mode_t;
+
+#define ESP_ERR_NVS_NO_FREE_PAGES 0x110d
+#define ESP_ERR_NVS_NOT_FOUND 0x1102
+#define ESP_ERR_NVS_NEW_VERSION_FOUND 0x1110
+#define ESP_ERR_NVS_INVALID_LENGTH 0x110c
+
+esp_err_t nvs_flash_init();
+esp_err_t nvs_flash_erase();
+esp_err_t nvs_open(const char *, nvs_open_mode_t, nvs_handle_t *);
+esp_err_t nvs_get_blob(nvs_handle_t, const char *, void *, size_t *);
+esp_err_t nvs_set_blob(nvs_handle_t, const char *, const void *, size_t);
+esp_err_t nvs_erase_key(nvs_handle_t, const char *);
+esp_err_t nvs_commit(nvs_handle_t);
+void nvs_close(nvs_handle_t);
+
+#endif
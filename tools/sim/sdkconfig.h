@@ -0,0 +1,5 @@
+// Stand-in for the simulator, see sim.c: default configuration, PWM light output.
+#ifndef _SIM_SDKCONFIG_H
+#define _SIM_SDKCONFIG_H
+
+#endif
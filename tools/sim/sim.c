@@ -0,0 +1,694 @@
+// Run the alarm engine on a virtual clock, on the host:
+// cc -O2 -I. -I../../main -Wl,--wrap=resume_save -o simulate sim.c
+//   ../../main/{engine,schedule,zone,light,resume,data,snapshot,field}.c
+// ./simulate clock.bin 2026-03-01 31 [restarts] > timeline.csv
+// The engine, schedule, LED output, resume and storage code is the firmware one; FreeRTOS, LEDC, NVS, RTC memory and
+// the clock are the stand-ins below. The duty timeline goes to stdout as csv, the summary with the wake up count to
+// stderr. With restarts the span runs again, reset at that many random instants: clean resets must restore the clock
+// and put the light back on the uninterrupted timeline until the engine takes over, torn or corrupted RTC memory and
+// power on resets must restore nothing.
+#include <limits.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include "data.h"
+#include "engine.h"
+#include "snapshot.h"
+#include "schedule.h"
+#include "zone.h"
+#include "sound.h"
+#include "ambient.h"
+#include "resume.h"
+#include "latency.h"
+#include "power.h"
+#include "log.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "driver/ledc.h"
+#include "nvs_flash.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "esp_rtc_time.h"
+#include "esp_rom_crc.h"
+
+#define SIM_BOOT 300000         // microseconds from reset to resume_restore
+#define SIM_TAKEOVER 2000000    // and at least this much longer until the engine runs, wifi and clock sync
+#define SIM_FAILURES 10         // reported in detail
+#define SIM_SEMAPHORES 8
+
+enum sim_reset {
+    SIM_CLEAN = 0,
+    SIM_TORN,                   // reset during resume_save, RTC memory half old and half new
+    SIM_CORRUPT,                // a bit of RTC memory flipped
+    SIM_POWER_ON,
+    SIM_RESETS,
+};
+
+struct sim_semaphore {
+    bool mutex;
+    bool given;
+};
+
+struct sim_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    long long period;           // microseconds, 0 when stopped
+    long long next;
+};
+
+struct sim_output {
+    long long time;
+    unsigned int duty[LEDC_CHANNEL_MAX];
+};
+
+struct sim_save {
+    long long time;
+    struct schedule schedule;
+};
+
+struct sim_tally {
+    unsigned int restarts;
+    unsigned int restores;
+    unsigned int rejected[SIM_RESETS];
+    unsigned int compared;
+    unsigned int failures;
+};
+
+// RTC_NOINIT_ATTR of esp_attr.h, the state of resume.c
+extern unsigned char __start_rtc_noinit[];
+extern unsigned char __stop_rtc_noinit[];
+
+static long long now;           // virtual clock, epoch microseconds
+static long long boot;
+static long long end;
+static jmp_buf finish;
+static unsigned int wakes = 0;
+static unsigned int changes = 0;
+static unsigned int rings = 0;
+static unsigned int duty[LEDC_CHANNEL_MAX];
+static unsigned int shown[LEDC_CHANNEL_MAX];
+static bool quiet = false;      // restarts run, outputs compared rather than printed
+static long long interrupt = LLONG_MAX; // next reset
+static long long powered;       // RTC timer start
+static esp_reset_reason_t reason = ESP_RST_POWERON;
+static long long restored;      // clock set by resume_restore, 0 without
+static struct sim_timer timer;
+static struct sim_output *outputs = NULL;       // uninterrupted timeline
+static size_t output_count = 0, output_size = 0;
+static struct sim_save *saves = NULL;
+static size_t save_count = 0, save_size = 0;
+static struct schedule saved;   // last one resume_save got
+static unsigned char previous[256];     // RTC memory before it
+static struct {
+    char key[16];               // empty when free
+    unsigned char value[sizeof(struct data) + 1];
+    size_t size;
+} blobs[4];
+
+static int sim_load(const char *);
+static int sim_restarts(struct data *, long long, unsigned int);
+static enum sim_reset sim_reset();
+static void sim_boot(enum sim_reset, bool, struct sim_tally *);
+static void sim_compare(bool, struct sim_tally *);
+static void sim_fail(struct sim_tally *, const char *, ...);
+static size_t sim_search(const void *, size_t, size_t, long long);
+static int sim_order(const void *, const void *);
+static SemaphoreHandle_t sim_create(bool);
+static bool sim_grow(void **, size_t *, size_t, size_t);
+
+int main(int argc, char **argv)
+{
+    if (argc != 4 && argc != 5) {
+        fprintf(stderr, "Usage: %s <snapshot> <YYYY-MM-DD> <days> [restarts]\n", argv[0]);
+        return 1;
+    }
+    if (sim_load(argv[1])) {
+        return 1;
+    }
+    struct data data = { 0 };
+    const char *err;
+    if ((err = data_read(&data))) {
+        fprintf(stderr, "%s\n", err);
+        return 1;
+    }
+    struct tm tm = { 0 };
+    if (sscanf(argv[2], "%d-%d-%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday) != 3) {
+        fprintf(stderr, "Invalid start date\n");
+        return 1;
+    }
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    tm.tm_isdst = -1;
+    long long first = powered = boot = now = zone_epoch(&tm) * 1000000LL;
+    end = now + atoi(argv[3]) * 86400000000LL;
+    if (sizeof(previous) < (size_t)(__stop_rtc_noinit - __start_rtc_noinit)) {
+        fprintf(stderr, "RTC memory larger than the copy\n");
+        return 1;
+    }
+    memset(shown, 0xFF, sizeof(shown));
+    if ((err = engine_init())) {
+        fprintf(stderr, "%s\n", err);
+        return 1;
+    }
+    struct timespec start, stop;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    printf("time,channel,duty\n");
+    resume_trust();
+    if (!setjmp(finish)) {
+        SemaphoreHandle_t signal = xSemaphoreCreateBinary();
+        engine_run(&data, &signal);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    double days = (now - boot) / 86400e6;
+    fprintf(stderr, "%.1f days in %.1f ms: %u wake ups (%.1f per day), %u duty changes, %u rings\n", days,
+            (stop.tv_sec - start.tv_sec) * 1e3 + (stop.tv_nsec - start.tv_nsec) / 1e6, wakes, wakes / days, changes,
+            rings);
+    return argc == 5 ? sim_restarts(&data, first, atoi(argv[4])) : 0;
+}
+
+// Same span with resets at random instants between the engine wake ups.
+static int sim_restarts(struct data *data, long long first, unsigned int count)
+{
+    long long *resets = malloc((count + 1) * sizeof(long long));
+    if (!resets || !save_count) {
+        fprintf(stderr, "Nothing to restart\n");
+        return 1;
+    }
+    srand(1);
+    for (unsigned int i = 0; i < count; i++) {
+        size_t j = ((size_t)rand() << 16 ^ rand()) % save_count;
+        long long from = saves[j].time;
+        long long to = j + 1 < save_count ? saves[j + 1].time : end;
+        resets[i] = from + 1 + ((long long)rand() << 16 ^ rand()) % (to - from - 1);
+    }
+    qsort(resets, count, sizeof(long long), sim_order);
+    struct sim_tally tally = { 0 };
+    unsigned int next = 0;
+    enum sim_reset kind = SIM_POWER_ON;
+    SemaphoreHandle_t signal = xSemaphoreCreateBinary();
+    quiet = true;
+    powered = now = first;
+    memset(__start_rtc_noinit, 0, __stop_rtc_noinit - __start_rtc_noinit);
+    memset(duty, 0, sizeof(duty));
+    for (;;) {
+        sim_boot(kind, next > 0, &tally);
+        if (now >= end) {
+            break;
+        }
+        resume_stop();
+        resume_trust();
+        // resets due while booting never happen
+        while (next < count && resets[next] <= now) {
+            next++;
+        }
+        interrupt = next < count ? resets[next] : LLONG_MAX;
+        if (!setjmp(finish)) {
+            engine_run(data, &signal);
+        }
+        if (now >= end) {
+            break;
+        }
+        next++;
+        tally.restarts++;
+        kind = sim_reset();
+        memset(duty, 0, sizeof(duty));
+        timer.period = 0;
+        now += SIM_BOOT;
+        if (kind == SIM_POWER_ON) {
+            powered = now;
+        }
+    }
+    free(resets);
+    fprintf(stderr, "%u restarts: %u restored, %u torn, %u corrupted and %u power on rejected, %u outputs compared, "
+            "%u failures\n", tally.restarts, tally.restores, tally.rejected[SIM_TORN], tally.rejected[SIM_CORRUPT],
+            tally.rejected[SIM_POWER_ON], tally.compared, tally.failures);
+    return tally.failures ? 1 : 0;
+}
+
+// Reset while the engine waits, torn and corrupt ones damage what resume_save left in RTC memory.
+static enum sim_reset sim_reset()
+{
+    enum sim_reset kind = rand() % 2 ? SIM_CLEAN : SIM_TORN + rand() % (SIM_RESETS - SIM_TORN);
+    unsigned char *rtc = __start_rtc_noinit;
+    size_t size = __stop_rtc_noinit - __start_rtc_noinit;
+    if (kind == SIM_TORN) {
+        size_t low = 0, high = size;
+        while (low < size && rtc[low] == previous[low]) {
+            low++;
+        }
+        while (high > low && rtc[high - 1] == previous[high - 1]) {
+            high--;
+        }
+        if (high - low < 2) {
+            kind = SIM_CORRUPT;
+        } else {
+            // written front to back, cut after the first changed byte and before the last
+            size_t cut = low + 1 + rand() % (high - low - 1);
+            memcpy(rtc + cut, previous + cut, size - cut);
+        }
+    }
+    if (kind == SIM_CORRUPT) {
+        rtc[rand() % size] ^= 1 << rand() % 8;
+    }
+    reason = kind == SIM_POWER_ON ? ESP_RST_POWERON :
+        (esp_reset_reason_t[]) { ESP_RST_SW, ESP_RST_PANIC, ESP_RST_TASK_WDT, ESP_RST_INT_WDT }[rand() % 4];
+    return kind;
+}
+
+// From reset to the engine: resume_restore, then the resume timer alone until wifi and the clock are up.
+static void sim_boot(enum sim_reset kind, bool reset, struct sim_tally *tally)
+{
+    boot = now;
+    restored = 0;
+    const char *err = resume_restore();
+    bool valid = reset && kind == SIM_CLEAN;
+    if (err || (valid ? restored != now : restored || timer.period)) {
+        sim_fail(tally, "reset %d: %s, clock restored to %lld", kind, err ? err : "unexpected", restored);
+    } else if (valid) {
+        tally->restores++;
+    } else if (reset) {
+        tally->rejected[kind]++;
+    }
+    long long takeover = now + SIM_TAKEOVER + rand() % SIM_TAKEOVER;
+    if (takeover > end) {
+        takeover = end;
+    }
+    sim_compare(valid, tally);
+    while (timer.period && timer.next < takeover) {
+        now = timer.next;
+        timer.next += timer.period;
+        timer.callback(timer.arg);
+        sim_compare(valid, tally);
+    }
+    now = takeover;
+}
+
+// The resumed light equals the uninterrupted timeline while that still shows the saved phase, and stays off without a
+// restore.
+static void sim_compare(bool valid, struct sim_tally *tally)
+{
+    static const unsigned int off[LEDC_CHANNEL_MAX] = { 0 };
+    const unsigned int *expected = off;
+    if (valid) {
+        size_t i = sim_search(saves, save_count, sizeof(*saves), now);
+        if (i == save_count || memcmp(&saves[i].schedule, &saved, sizeof(saved))) {
+            return;
+        }
+        size_t j = sim_search(outputs, output_count, sizeof(*outputs), now);
+        if (j < output_count) {
+            expected = outputs[j].duty;
+        }
+    }
+    tally->compared++;
+    if (memcmp(duty, expected, sizeof(duty))) {
+        sim_fail(tally, "phase %u duty %u,%u,%u, uninterrupted %u,%u,%u", saved.phase, duty[0], duty[1], duty[2],
+                 expected[0], expected[1], expected[2]);
+    }
+}
+
+static void sim_fail(struct sim_tally *tally, const char *format, ...)
+{
+    if (tally->failures++ >= SIM_FAILURES) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "%lld.%06lld: ", now / 1000000, now % 1000000);
+    vfprintf(stderr, format, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+}
+
+// Last item at or before now by the time leading each, count without one.
+static size_t sim_search(const void *items, size_t count, size_t size, long long time)
+{
+    size_t low = 0, high = count;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        if (*(const long long *)((const char *)items + middle * size) <= time) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low ? low - 1 : count;
+}
+
+static int sim_order(const void *a, const void *b)
+{
+    return *(const long long *)a < *(const long long *)b ? -1 : *(const long long *)a > *(const long long *)b;
+}
+
+static bool sim_grow(void **items, size_t *size, size_t count, size_t item)
+{
+    if (count < *size) {
+        return true;
+    }
+    void *grown = realloc(*items, (*size ? *size * 2 : 4096) * item);
+    if (!grown) {
+        return false;
+    }
+    *items = grown;
+    *size = *size ? *size * 2 : 4096;
+    return true;
+}
+
+// Snapshot produced by tools/snapshot, stored as the NVS blobs data_read will find.
+static int sim_load(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        return 1;
+    }
+    struct snapshot snapshot;
+    snapshot_begin(&snapshot);
+    unsigned char buffer[64];
+    size_t size;
+    const char *err = NULL;
+    while (!err && (size = fread(buffer, 1, sizeof(buffer), file))) {
+        err = snapshot_feed(&snapshot, buffer, size);
+    }
+    fclose(file);
+    if (err || (err = snapshot_end(&snapshot))) {
+        fprintf(stderr, "%s\n", err);
+        return 1;
+    }
+    if ((err = data_write(&snapshot.data))) {
+        fprintf(stderr, "%s\n", err);
+        return 1;
+    }
+    return 0;
+}
+
+time_t time(time_t *result)
+{
+    time_t seconds = now / 1000000;
+    if (result) {
+        *result = seconds;
+    }
+    return seconds;
+}
+
+int64_t esp_timer_get_time()
+{
+    return now - boot;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *handle)
+{
+    timer.callback = args->callback;
+    timer.arg = args->arg;
+    timer.period = 0;
+    *handle = &timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t handle, uint64_t period)
+{
+    handle->period = period;
+    handle->next = now + period;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t handle)
+{
+    handle->period = 0;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t handle)
+{
+    return ESP_OK;
+}
+
+int gettimeofday(struct timeval *restrict tv, void *restrict tz)
+{
+    tv->tv_sec = now / 1000000;
+    tv->tv_usec = now % 1000000;
+    return 0;
+}
+
+// The virtual clock stays, restores are checked against it.
+int settimeofday(const struct timeval *tv, const struct timezone *tz)
+{
+    restored = tv->tv_sec * 1000000LL + tv->tv_usec;
+    return 0;
+}
+
+esp_reset_reason_t esp_reset_reason()
+{
+    return reason;
+}
+
+uint64_t esp_rtc_get_time_us()
+{
+    return now - powered;
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buffer, uint32_t length)
+{
+    crc = ~crc;
+    while (length--) {
+        crc ^= *buffer++;
+        for (int i = 0; i < 8; i++) {
+            crc = crc >> 1 ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+    return sim_create(false);
+}
+
+// The engine sleeps here, the virtual clock jumps to its wake up.
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks)
+{
+    if (semaphore->given) {
+        semaphore->given = false;
+        return pdTRUE;
+    }
+    // a single task, nothing else could give it back
+    if (semaphore->mutex) {
+        fprintf(stderr, "Mutex taken while held\n");
+        exit(1);
+    }
+    long long until = now + ticks * (1000000LL / configTICK_RATE_HZ);
+    if (until >= interrupt) {
+        now = interrupt;
+        longjmp(finish, 1);
+    }
+    now = until;
+    if (now >= end) {
+        longjmp(finish, 1);
+    }
+    wakes += !quiet;
+    return pdFALSE;
+}
+
+// Single task, the light lock is always free.
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    return sim_create(true);
+}
+
+// Every lock its own object, like the heap ones of FreeRTOS.
+static SemaphoreHandle_t sim_create(bool mutex)
+{
+    static struct sim_semaphore semaphores[SIM_SEMAPHORES];
+    static unsigned int count = 0;
+    if (count == SIM_SEMAPHORES) {
+        return NULL;
+    }
+    semaphores[count] = (struct sim_semaphore) {.mutex = mutex,.given = mutex };
+    return &semaphores[count++];
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    semaphore->given = true;
+    return pdTRUE;
+}
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t *config)
+{
+    return ESP_OK;
+}
+
+esp_err_t ledc_channel_config(const ledc_channel_config_t *config)
+{
+    duty[config->channel] = config->duty;
+    return ESP_OK;
+}
+
+esp_err_t ledc_set_duty(ledc_mode_t mode, ledc_channel_t channel, uint32_t value)
+{
+    duty[channel] = value;
+    return ESP_OK;
+}
+
+esp_err_t ledc_update_duty(ledc_mode_t mode, ledc_channel_t channel)
+{
+    if (quiet || duty[channel] == shown[channel]) {
+        return ESP_OK;
+    }
+    shown[channel] = duty[channel];
+    changes++;
+    printf("%lld.%03lld,led%d,%u\n", now / 1000000, now / 1000 % 1000, channel, duty[channel]);
+    if (!sim_grow((void **)&outputs, &output_size, output_count, sizeof(*outputs))) {
+        return ESP_ERR_NO_MEM;
+    }
+    outputs[output_count].time = now;
+    memcpy(outputs[output_count++].duty, shown, sizeof(shown));
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_init()
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase()
+{
+    memset(blobs, 0, sizeof(blobs));
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *namespace, nvs_open_mode_t mode, nvs_handle_t *handle)
+{
+    *handle = 1;
+    for (unsigned char i = 0; i < sizeof(blobs) / sizeof(*blobs); i++) {
+        if (*blobs[i].key) {
+            return ESP_OK;
+        }
+    }
+    return mode == NVS_READONLY ? ESP_ERR_NVS_NOT_FOUND : ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *value, size_t *size)
+{
+    for (unsigned char i = 0; i < sizeof(blobs) / sizeof(*blobs); i++) {
+        if (!strcmp(blobs[i].key, key)) {
+            if (value && *size < blobs[i].size) {
+                return ESP_ERR_NVS_INVALID_LENGTH;
+            }
+            if (value) {
+                memcpy(value, blobs[i].value, blobs[i].size);
+            }
+            *size = blobs[i].size;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t size)
+{
+    unsigned char slot = sizeof(blobs) / sizeof(*blobs);
+    for (unsigned char i = 0; i < sizeof(blobs) / sizeof(*blobs); i++) {
+        if (!strcmp(blobs[i].key, key) || (!*blobs[i].key && slot == sizeof(blobs) / sizeof(*blobs))) {
+            slot = i;
+        }
+    }
+    if (!*key || strlen(key) >= sizeof(blobs->key) || slot == sizeof(blobs) / sizeof(*blobs) ||
+        size > sizeof(blobs->value)) {
+        return ESP_FAIL;
+    }
+    strcpy(blobs[slot].key, key);
+    memcpy(blobs[slot].value, value, size);
+    blobs[slot].size = size;
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    for (unsigned char i = 0; i < sizeof(blobs) / sizeof(*blobs); i++) {
+        if (!strcmp(blobs[i].key, key)) {
+            memset(&blobs[i], 0, sizeof(*blobs));
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+}
+
+// Firmware modules outside of the simulation.
+
+const char *ambient_init()
+{
+    return NULL;
+}
+
+const char *sound_init()
+{
+    return NULL;
+}
+
+const char *sound_start(unsigned char melody, unsigned char volume, unsigned int fade, unsigned int elapsed)
+{
+    if (quiet) {
+        return NULL;
+    }
+    rings++;
+    printf("%lld.%03lld,ring,%u\n", now / 1000000, now / 1000 % 1000, volume);
+    return NULL;
+}
+
+void sound_stop()
+{
+    if (quiet) {
+        return;
+    }
+    printf("%lld.%03lld,ring,0\n", now / 1000000, now / 1000 % 1000);
+}
+
+void __real_resume_save(const struct schedule *);
+
+// Every save of the engine, for the comparison and the torn resets.
+void __wrap_resume_save(const struct schedule *schedule)
+{
+    if (!quiet && sim_grow((void **)&saves, &save_size, save_count, sizeof(*saves))) {
+        saves[save_count].time = now;
+        saves[save_count++].schedule = *schedule;
+    }
+    memcpy(previous, __start_rtc_noinit, __stop_rtc_noinit - __start_rtc_noinit);
+    saved = *schedule;
+    __real_resume_save(schedule);
+}
+
+void latency_record(enum latency_task task, long long target)
+{
+}
+
+void latency_log()
+{
+}
+
+void power_hold(enum power_holder holder, bool active)
+{
+}
+
+void log_info(const char *message)
+{
+    fprintf(stderr, "%s\n", message);
+}
+
+void log_error(const char *message)
+{
+    fprintf(stderr, "%s\n", message);
+}
@@ -0,0 +1,140 @@
+// Encode and decode configuration snapshots offline, on the host:
+// cc -O2 -I../main -o snapshot snapshot.c ../main/snapshot.c ../main/field.c
+// ./snapshot encode clock.txt clock.bin && ./snapshot decode clock.bin
+// Text lines are key=value with ssid, password, timezone and alarm.<n>.<field> keys, the highest n sets the count.
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "snapshot.h"
+#include "field.h"
+
+static int snapshot_encode_file(FILE *, FILE *);
+static int snapshot_decode_file(FILE *, FILE *);
+static int snapshot_set(struct data *, const char *, const char *);
+
+int main(int argc, char **argv)
+{
+    if (argc < 3 || argc > 4 || (strcmp(argv[1], "encode") && strcmp(argv[1], "decode"))) {
+        fprintf(stderr, "Usage: %s encode|decode <input> [output]\n", argv[0]);
+        return 1;
+    }
+    bool encode = !strcmp(argv[1], "encode");
+    FILE *in = fopen(argv[2], encode ? "r" : "rb");
+    if (!in) {
+        perror(argv[2]);
+        return 1;
+    }
+    FILE *out = argc == 4 ? fopen(argv[3], encode ? "wb" : "w") : stdout;
+    if (!out) {
+        perror(argv[3]);
+        fclose(in);
+        return 1;
+    }
+    int result = encode ? snapshot_encode_file(in, out) : snapshot_decode_file(in, out);
+    fclose(in);
+    if (out != stdout) {
+        fclose(out);
+    }
+    return result;
+}
+
+static int snapshot_encode_file(FILE *in, FILE *out)
+{
+    struct data data = { 0 };
+    char line[256];
+    for (unsigned int number = 1; fgets(line, sizeof(line), in); number++) {
+        line[strcspn(line, "\r\n")] = 0;
+        if (!*line || *line == '#') {
+            continue;
+        }
+        char *value = strchr(line, '=');
+        if (!value) {
+            fprintf(stderr, "Line %u: expected key=value\n", number);
+            return 1;
+        }
+        *value++ = 0;
+        if (snapshot_set(&data, line, value)) {
+            fprintf(stderr, "Line %u: invalid %s\n", number, line);
+            return 1;
+        }
+    }
+    for (unsigned short i = 0; i < data.alarms; i++) {
+        if (!field_valid(&data.alarm[i])) {
+            fprintf(stderr, "Alarm %u: a year needs a month and a day\n", i);
+            return 1;
+        }
+    }
+    unsigned char buffer[SNAPSHOT_SIZE];
+    size_t size = snapshot_encode(&data, buffer);
+    return fwrite(buffer, 1, size, out) == size ? 0 : 1;
+}
+
+static int snapshot_decode_file(FILE *in, FILE *out)
+{
+    struct snapshot snapshot;
+    snapshot_begin(&snapshot);
+    unsigned char buffer[64];
+    size_t size;
+    const char *err = NULL;
+    while (!err && (size = fread(buffer, 1, sizeof(buffer), in))) {
+        err = snapshot_feed(&snapshot, buffer, size);
+    }
+    if (err || (err = snapshot_end(&snapshot))) {
+        fprintf(stderr, "%s\n", err);
+        return 1;
+    }
+    fprintf(out, "ssid=%s\npassword=%s\ntimezone=%s\n", snapshot.data.ssid, snapshot.data.password,
+            snapshot.data.timezone);
+    for (unsigned char i = 0; i < snapshot.count; i++) {
+        for (unsigned char j = 0; j < FIELD_ALARM; j++) {
+            fprintf(out, "alarm.%u.%s=%u\n", i, field_alarm[j].name,
+                    ((unsigned char *)&snapshot.data.alarm[i])[field_alarm[j].offset]);
+        }
+    }
+    return 0;
+}
+
+static int snapshot_set(struct data *data, const char *key, const char *value)
+{
+    char *target = NULL;
+    size_t size = 0;
+    if (!strcmp(key, "ssid")) {
+        target = data->ssid;
+        size = sizeof(data->ssid);
+    } else if (!strcmp(key, "password")) {
+        target = data->password;
+        size = sizeof(data->password);
+    } else if (!strcmp(key, "timezone")) {
+        target = data->timezone;
+        size = sizeof(data->timezone);
+    }
+    if (target) {
+        if (strlen(value) >= size) {
+            return 1;
+        }
+        strcpy(target, value);
+        return 0;
+    }
+    unsigned int index;
+    int offset;
+    if (sscanf(key, "alarm.%u.%n", &index, &offset) != 1 || index >= DATA_ALARMS) {
+        return 1;
+    }
+    for (unsigned char i = 0; i < FIELD_ALARM; i++) {
+        if (!strcmp(key + offset, field_alarm[i].name)) {
+            char *end;
+            long number = strtol(value, &end, 0);
+            if (!*value || *end || number < 0 || number > field_alarm[i].max) {
+                return 1;
+            }
+            ((unsigned char *)&data->alarm[index])[field_alarm[i].offset] = number;
+            if (index >= data->alarms) {
+                data->alarms = index + 1;
+            }
+            return 0;
+        }
+    }
+    return 1;
+}
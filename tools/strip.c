@@ -0,0 +1,86 @@
+// Render the strip sunrise to an image and report the render and encode cost per LED, on the host:
+// cc -O2 -I../main -o strip strip.c ../main/strip.c && ./strip 60 300 sunrise.ppm sunrise.spi
+// One image row per frame from dark to full level, one column per LED from the bottom of the strip. The optional
+// second file gets the spi stream of every frame as the light output sends it.
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "strip.h"
+
+#define STRIP_ROUNDS 2000
+
+static double strip_elapsed(const struct timespec *, const struct timespec *);
+
+int main(int argc, char **argv)
+{
+    if (argc != 4 && argc != 5) {
+        fprintf(stderr, "Usage: %s <leds> <frames> <output.ppm> [output.spi]\n", argv[0]);
+        return 1;
+    }
+    int count = atoi(argv[1]);
+    int frames = atoi(argv[2]);
+    if (count < 1 || count > 1000 || frames < 2) {
+        fprintf(stderr, "Between 1 and 1000 LEDs and at least 2 frames.\n");
+        return 1;
+    }
+    FILE *image = fopen(argv[3], "wb");
+    if (!image) {
+        perror(argv[3]);
+        return 1;
+    }
+    FILE *stream = NULL;
+    if (argc == 5 && !(stream = fopen(argv[4], "wb"))) {
+        perror(argv[4]);
+        return 1;
+    }
+    strip_init();
+    const unsigned char bottom[3] = STRIP_SUNRISE_BOTTOM;
+    const unsigned char top[3] = STRIP_SUNRISE_TOP;
+    unsigned char *frame = malloc(count * 3);
+    unsigned char *spi = malloc(STRIP_SIZE(count));
+    if (!frame || !spi) {
+        fprintf(stderr, "No memory.\n");
+        return 1;
+    }
+    fprintf(image, "P6\n%d %d\n255\n", count, frames);
+    for (int i = 0; i < frames; i++) {
+        strip_rise(frame, count, bottom, top, i * 255 / (frames - 1));
+        fwrite(frame, 3, count, image);
+        if (stream) {
+            fwrite(spi, 1, strip_encode(frame, count, spi), stream);
+        }
+    }
+    fclose(image);
+    if (stream) {
+        fclose(stream);
+    }
+    // every level once per round, render and encode timed apart
+    struct timespec start, end;
+    unsigned int check = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int round = 0; round < STRIP_ROUNDS; round++) {
+        strip_rise(frame, count, bottom, top, round);
+        check += frame[count * 3 / 2];
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double render = strip_elapsed(&start, &end);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int round = 0; round < STRIP_ROUNDS; round++) {
+        frame[round % (count * 3)] = round;
+        check += strip_encode(frame, count, spi) + spi[round % STRIP_SIZE(count)];
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double encode = strip_elapsed(&start, &end);
+    printf("%d LEDs, render %.2f ns, encode %.2f ns per LED, %d bytes and %.0f us on the bus per frame (%u)\n",
+           count, render / STRIP_ROUNDS / count, encode / STRIP_ROUNDS / count, STRIP_SIZE(count),
+           STRIP_SIZE(count) * 8 * 1e6 / STRIP_RATE, check & 1);
+    free(frame);
+    free(spi);
+    return 0;
+}
+
+static double strip_elapsed(const struct timespec *start, const struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
@@ -0,0 +1,72 @@
+// Render the ring melodies to a WAV file and report the per sample cost, on the host:
+// cc -O2 -I../main -o synth synth.c ../main/synth.c && ./synth 1 96 30 chime.wav
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "synth.h"
+
+static void synth_header(FILE *, unsigned int);
+static void synth_word(FILE *, unsigned int, int);
+
+int main(int argc, char **argv)
+{
+    if (argc != 5) {
+        fprintf(stderr, "Usage: %s <melody> <volume> <fade seconds> <output.wav>\n", argv[0]);
+        return 1;
+    }
+    unsigned char melody = atoi(argv[1]);
+    unsigned char volume = atoi(argv[2]);
+    unsigned int fade = atoi(argv[3]) * SYNTH_RATE;
+    FILE *file = fopen(argv[4], "wb");
+    if (!file) {
+        perror(argv[4]);
+        return 1;
+    }
+    // fade plus five seconds at full volume
+    unsigned int total = fade + 5 * SYNTH_RATE;
+    synth_header(file, total);
+    synth_init();
+    struct synth synth;
+    synth_start(&synth, melody, volume, fade, 0);
+    short buffer[256];
+    struct timespec start, end;
+    double elapsed = 0;
+    for (unsigned int left = total; left;) {
+        unsigned int count = left < 256 ? left : 256;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        synth_render(&synth, buffer, count);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        elapsed += (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+        for (unsigned int i = 0; i < count; i++) {
+            synth_word(file, (unsigned short)buffer[i], 2);
+        }
+        left -= count;
+    }
+    fclose(file);
+    printf("%u samples, %.2f ns per sample\n", total, elapsed / total);
+    return 0;
+}
+
+static void synth_header(FILE *file, unsigned int samples)
+{
+    fwrite("RIFF", 1, 4, file);
+    synth_word(file, 36 + samples * 2, 4);
+    fwrite("WAVEfmt ", 1, 8, file);
+    synth_word(file, 16, 4);
+    synth_word(file, 1, 2);     // pcm
+    synth_word(file, 1, 2);     // mono
+    synth_word(file, SYNTH_RATE, 4);
+    synth_word(file, SYNTH_RATE * 2, 4);
+    synth_word(file, 2, 2);
+    synth_word(file, 16, 2);
+    fwrite("data", 1, 4, file);
+    synth_word(file, samples * 2, 4);
+}
+
+static void synth_word(FILE *file, unsigned int value, int size)
+{
+    for (int i = 0; i < size; i++) {
+        fputc(value >> (i * 8) & 0xFF, file);
+    }
+}
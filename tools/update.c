@@ -0,0 +1,96 @@
+// Stream a firmware image through the update pipeline into a file, on the host:
+// cc -O2 -I../main -o update update.c ../main/update.c ../main/sha256.c
+// ./update build/alarm.bin slot.bin [sha256]
+#include <stdio.h>
+#include <time.h>
+
+#include "update.h"
+
+static const char *update_file_begin(void *, size_t);
+static const char *update_file_write(void *, const void *, size_t);
+static const char *update_file_end(void *);
+static void update_file_abort(void *);
+
+// stands in for the inactive app partition
+static const struct update_writer writer = {
+    .begin = update_file_begin,
+    .write = update_file_write,
+    .end = update_file_end,
+    .abort = update_file_abort,
+};
+
+static const char *path;
+static FILE *slot;
+
+int main(int argc, char **argv)
+{
+    if (argc < 3 || argc > 4) {
+        fprintf(stderr, "Usage: %s <image> <slot> [sha256]\n", argv[0]);
+        return 1;
+    }
+    unsigned char expected[32];
+    for (int i = 0; argc == 4 && i < 32; i++) {
+        unsigned int byte;
+        if (sscanf(argv[3] + i * 2, "%2x", &byte) != 1) {
+            fprintf(stderr, "Invalid sha256\n");
+            return 1;
+        }
+        expected[i] = byte;
+    }
+    FILE *image = fopen(argv[1], "rb");
+    if (!image) {
+        perror(argv[1]);
+        return 1;
+    }
+    fseek(image, 0, SEEK_END);
+    size_t size = ftell(image);
+    rewind(image);
+    path = argv[2];
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    struct update update;
+    const char *err = update_begin(&update, &writer, NULL, size);
+    // one TCP segment per chunk, as httpd_req_recv hands them over
+    char buffer[1436];
+    size_t received;
+    while (!err && (received = fread(buffer, 1, sizeof(buffer), image))) {
+        if ((err = update_write(&update, buffer, received))) {
+            update_abort(&update);
+        }
+    }
+    fclose(image);
+    unsigned char digest[32];
+    if (err || (err = update_end(&update, argc == 4 ? expected : NULL, digest))) {
+        fprintf(stderr, "%s\n", err);
+        return 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    for (int i = 0; i < 32; i++) {
+        printf("%02x", digest[i]);
+    }
+    printf("  %zu bytes, %.3f s, %.1f MB/s\n", size, elapsed, size / elapsed / 1e6);
+    return 0;
+}
+
+static const char *update_file_begin(void *context, size_t size)
+{
+    slot = fopen(path, "wb");
+    return slot ? NULL : "Unable to open slot.";
+}
+
+static const char *update_file_write(void *context, const void *data, size_t size)
+{
+    return fwrite(data, 1, size, slot) == size ? NULL : "Unable to write slot.";
+}
+
+static const char *update_file_end(void *context)
+{
+    return fclose(slot) ? "Unable to close slot." : NULL;
+}
+
+static void update_file_abort(void *context)
+{
+    fclose(slot);
+    remove(path);
+}
@@ -0,0 +1,198 @@
+// Check the timezone table against glibc and benchmark both, on the host:
+// cc -O2 -I../main -o zone zone.c ../main/zone.c && ./zone ['CET-1CEST,M3.5.0,M10.5.0/3' ...]
+// Every rule is compared at random instants and local times from 1990 to 2060 and at each offset change. Local times
+// repeated by a change are skipped, glibc picks one by its call history. The cost per conversion is taken on the first.
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "zone.h"
+
+#define ZONE_CHECKS 200000
+#define ZONE_BENCHMARK 1000000
+#define ZONE_START 631152000    // 1990-01-01
+#define ZONE_END 2840140800     // 2060-01-01
+
+// Not names of zoneinfo files, glibc would read those first. Rules left out take those of its posixrules file rather
+// than the US ones, and glibc switches year round daylight time off for the hours the next year starts earlier in UTC.
+static const char *rules[] = {
+    "CET-1CEST,M3.5.0,M10.5.0/3",
+    "GMT0BST,M3.5.0/1,M10.5.0",
+    "EET-2EEST,M3.5.0/3,M10.5.0/4",
+    "IST-1GMT0,M10.5.0,M3.5.0/1",
+    "EST5EDT4,M3.2.0/2:00:00,M11.1.0/2:00:00",
+    "AKST9AKDT,M3.2.0,M11.1.0",
+    "NST3:30NDT,M3.2.0,M11.1.0",
+    "<-02>2<-01>,M3.5.0/-1,M10.5.0/0",
+    "AEST-10AEDT,M10.1.0,M4.1.0/3",
+    "NZST-12NZDT,M9.5.0,M4.1.0/3",
+    "ACST-9:30ACDT,M10.1.0,M4.1.0/3",
+    "<+1030>-10:30<+11>-11,M10.1.0,M4.1.0",
+    "<-04>4<-03>,M9.1.6/24,M4.1.6/24",
+    "<+0330>-3:30<+0430>,J79/24,J263/24",
+    "ABC-4DEF,80/0,264/0",
+    "MSK-3",
+    "<+0545>-5:45",
+    "<+14>-14",
+    "HST10",
+    "",
+};
+
+static unsigned int zone_local_check(time_t, const char *);
+static unsigned int zone_epoch_check(struct tm *, unsigned int *, const char *);
+static bool zone_same(const struct tm *, const struct tm *);
+static double zone_elapsed(const struct timespec *, const struct timespec *);
+
+int main(int argc, char **argv)
+{
+    const char **list = argc > 1 ? (const char **)argv + 1 : rules;
+    int count = argc > 1 ? argc - 1 : (int)(sizeof(rules) / sizeof(*rules));
+    unsigned int failures = 0;
+    for (int i = 0; i < count; i++) {
+        setenv("TZ", list[i], 1);
+        tzset();
+        zone_set(list[i]);
+        srand(i + 1);
+        unsigned int mismatches = 0, skipped = 0, changes = 0;
+        for (unsigned int j = 0; j < ZONE_CHECKS; j++) {
+            time_t t = ZONE_START + ((time_t)rand() << 16 ^ rand()) % (ZONE_END - ZONE_START);
+            mismatches += zone_local_check(t, list[i]);
+            struct tm tm;
+            zone_local(t, &tm);
+            // out of range fields normalize like mktime
+            tm.tm_mday += rand() % 5 - 2;
+            tm.tm_min += rand() % 181 - 90;
+            tm.tm_isdst = -1;
+            mismatches += zone_epoch_check(&tm, &skipped, list[i]);
+        }
+        // around every offset change, found by stepping hours and bisecting
+        struct tm before, after;
+        for (time_t t = ZONE_START; t < ZONE_END; t += 3600) {
+            localtime_r(&t, &before);
+            time_t next = t + 3600;
+            localtime_r(&next, &after);
+            if (before.tm_gmtoff == after.tm_gmtoff) {
+                continue;
+            }
+            changes++;
+            for (time_t low = t, high = next; high - low > 1;) {
+                time_t middle = (low + high) / 2;
+                localtime_r(&middle, &after);
+                *(after.tm_gmtoff == before.tm_gmtoff ? &low : &high) = middle;
+                next = high;
+            }
+            for (time_t s = next - 2; s <= next + 1; s++) {
+                mismatches += zone_local_check(s, list[i]);
+            }
+            for (int k = -90; k <= 90; k += 15) {
+                struct tm tm;
+                time_t s = next + k * 60;
+                localtime_r(&s, &tm);
+                tm.tm_isdst = -1;
+                mismatches += zone_epoch_check(&tm, &skipped, list[i]);
+            }
+        }
+        printf("%-42s %u changes, %u repeated local times skipped, %u mismatches\n", *list[i] ? list[i] : "\"\"",
+               changes, skipped, mismatches);
+        failures += mismatches;
+    }
+
+    // steady state cost within a year, the way the schedule converts
+    setenv("TZ", list[0], 1);
+    tzset();
+    zone_set(list[0]);
+    time_t *instants = malloc(ZONE_BENCHMARK * sizeof(time_t));
+    struct tm *locals = malloc(ZONE_BENCHMARK * sizeof(struct tm));
+    if (!instants || !locals) {
+        fprintf(stderr, "No memory.\n");
+        return 1;
+    }
+    for (unsigned int i = 0; i < ZONE_BENCHMARK; i++) {
+        instants[i] = 1767225600 + ((time_t)rand() << 16 ^ rand()) % (365 * 86400);
+        zone_local(instants[i], &locals[i]);
+        locals[i].tm_isdst = -1;
+    }
+    struct timespec start, end;
+    struct tm tm;
+    volatile time_t sink = 0;
+    double costs[4];
+    for (int k = 0; k < 4; k++) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (unsigned int i = 0; i < ZONE_BENCHMARK; i++) {
+            if (k < 2) {
+                if (k) {
+                    localtime_r(&instants[i], &tm);
+                } else {
+                    zone_local(instants[i], &tm);
+                }
+                sink += tm.tm_hour;
+            } else {
+                tm = locals[i];
+                sink += k == 2 ? zone_epoch(&tm) : mktime(&tm);
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        costs[k] = zone_elapsed(&start, &end) / ZONE_BENCHMARK;
+    }
+    printf("%s: local time %.1f ns against %.1f ns with glibc, epoch %.1f ns against %.1f ns (%lld)\n", list[0],
+           costs[0], costs[1], costs[2], costs[3], (long long)sink);
+    free(instants);
+    free(locals);
+    return failures ? 1 : 0;
+}
+
+static unsigned int zone_local_check(time_t t, const char *rule)
+{
+    struct tm expected, tm;
+    localtime_r(&t, &expected);
+    zone_local(t, &tm);
+    if (zone_same(&tm, &expected)) {
+        return 0;
+    }
+    fprintf(stderr, "%s: local time of %lld is %04d-%02d-%02d %02d:%02d:%02d dst %d, glibc %04d-%02d-%02d "
+            "%02d:%02d:%02d dst %d\n", rule, (long long)t, tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour,
+            tm.tm_min, tm.tm_sec, tm.tm_isdst, expected.tm_year + 1900, expected.tm_mon + 1, expected.tm_mday,
+            expected.tm_hour, expected.tm_min, expected.tm_sec, expected.tm_isdst);
+    return 1;
+}
+
+static unsigned int zone_epoch_check(struct tm *local, unsigned int *skipped, const char *rule)
+{
+    struct tm expected = *local, tm = *local;
+    time_t wanted = mktime(&expected);
+    time_t t = zone_epoch(&tm);
+    // the same local time an offset change earlier or later is a repeated one
+    for (int delta = 1800; delta <= 7200; delta += 1800) {
+        struct tm other;
+        time_t s = t + delta;
+        localtime_r(&s, &other);
+        bool repeated = other.tm_hour == tm.tm_hour && other.tm_min == tm.tm_min && other.tm_mday == tm.tm_mday;
+        s = t - delta;
+        localtime_r(&s, &other);
+        if (repeated || (other.tm_hour == tm.tm_hour && other.tm_min == tm.tm_min && other.tm_mday == tm.tm_mday)) {
+            (*skipped)++;
+            return 0;
+        }
+    }
+    if (t == wanted && zone_same(&tm, &expected)) {
+        return 0;
+    }
+    fprintf(stderr, "%s: epoch of %04d-%02d-%02d %02d:%02d:%02d is %lld, glibc %lld\n", rule,
+            local->tm_year + 1900, local->tm_mon + 1, local->tm_mday, local->tm_hour, local->tm_min, local->tm_sec,
+            (long long)t, (long long)wanted);
+    return 1;
+}
+
+static bool zone_same(const struct tm *tm, const struct tm *expected)
+{
+    return tm->tm_year == expected->tm_year && tm->tm_mon == expected->tm_mon && tm->tm_mday == expected->tm_mday &&
+        tm->tm_hour == expected->tm_hour && tm->tm_min == expected->tm_min && tm->tm_sec == expected->tm_sec &&
+        tm->tm_wday == expected->tm_wday && tm->tm_yday == expected->tm_yday && tm->tm_isdst == expected->tm_isdst;
+}
+
+static double zone_elapsed(const struct timespec *start, const struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}